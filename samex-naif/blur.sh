@@ -54,6 +54,9 @@ if (( optimize )); then
     CC=(${CC[@]} -O3)
 fi
 
+# The gc uses threads for parallel marking.
+CC=(${CC[@]} -pthread)
+
 COMPILE_C=("${CC[@]}" -g -c -I"${PROJECT_DIR}/include")
 LINK_BIN=("${CC[@]}" -g)
 
@@ -42,12 +42,13 @@ CMETH_IMPL_rest_2(If, andThenElse, functions, thenFunction, elseFunction) {
             methCall(functions.elems[i], SYM(call), (zarray) {i, results});
 
         if (results[i] == NULL) {
-            return methCall(elseFunction, SYM(call), EMPTY_ZARRAY);
+            return methTailCall(elseFunction, SYM(call), EMPTY_ZARRAY,
+                false);
         }
     }
 
-    return
-        methCall(thenFunction, SYM(call), (zarray) {functions.size, results});
+    return methTailCall(thenFunction, SYM(call),
+        (zarray) {functions.size, results}, false);
 }
 
 // Documented in spec.
@@ -61,20 +62,20 @@ CMETH_IMPL_2_opt(If, cases, testFunction, valueFunctions, defaultFunction) {
     zvalue consequentFunction = cm_get(valueFunctions, value);
 
     if (consequentFunction != NULL) {
-        return FUN_CALL(consequentFunction, value);
+        return FUN_TAIL_CALL(consequentFunction, value);
     }
 
     return (defaultFunction == NULL)
         ? NULL
-        : FUN_CALL(defaultFunction, value);
+        : FUN_TAIL_CALL(defaultFunction, value);
 }
 
 // Documented in spec.
 CMETH_IMPL_2_opt(If, is, testFunction, isFunction, notFunction) {
     if (FUN_CALL(testFunction) != NULL) {
-        return FUN_CALL(isFunction);
+        return FUN_TAIL_CALL(isFunction);
     } else if (notFunction != NULL) {
-        return FUN_CALL(notFunction);
+        return FUN_TAIL_CALL(notFunction);
     } else {
         return NULL;
     }
@@ -111,7 +112,7 @@ CMETH_IMPL_1(If, maybeValue, function) {
 // Documented in spec.
 CMETH_IMPL_2(If, not, testFunction, notFunction) {
     if (FUN_CALL(testFunction) == NULL) {
-        return FUN_CALL(notFunction);
+        return FUN_TAIL_CALL(notFunction);
     } else {
         return NULL;
     }
@@ -134,9 +135,9 @@ CMETH_IMPL_2_opt(If, value, testFunction, valueFunction, voidFunction) {
     zvalue result = FUN_CALL(testFunction);
 
     if (result != NULL) {
-        return FUN_CALL(valueFunction, result);
+        return FUN_TAIL_CALL(valueFunction, result);
     } else if (voidFunction != NULL) {
-        return FUN_CALL(voidFunction);
+        return FUN_TAIL_CALL(voidFunction);
     } else {
         return NULL;
     }
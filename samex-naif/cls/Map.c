@@ -22,16 +22,77 @@
 //
 
 /**
- * Map structure.
+ * Map structure. Small maps are "flat," that is, they hold their mappings
+ * directly. Larger maps are held as persistent B+trees, whose interior
+ * nodes are instances of the private class `MapNode` and whose leaves are
+ * flat maps. Operations on tree maps copy just the path from the root
+ * to the affected leaf, sharing all the rest.
  */
 typedef struct {
     /** Number of mappings. */
     zint size;
 
-    /** List of mappings, in key-sorted order. */
+    /** Root node of the tree, for a tree map. `NULL` for a flat map. */
+    zvalue root;
+
+    /** List of mappings, in key-sorted order. Empty for a tree map. */
     zmapping elems[/*size*/];
 } MapInfo;
 
+/**
+ * Entry in a `MapNode`.
+ */
+typedef struct {
+    /**
+     * Separator key. All keys in `child` are greater than or equal to this
+     * key, and all keys in the previous entry's `child` are less than it.
+     * This is not significant for the first entry of a node.
+     */
+    zvalue minKey;
+
+    /** Child node. Either a flat map or a `MapNode`. */
+    zvalue child;
+} MapNodeEntry;
+
+/**
+ * `MapNode` structure.
+ */
+typedef struct {
+    /** Total number of mappings under this node. */
+    zint size;
+
+    /** Number of children. */
+    zint count;
+
+    /** Children, in key-sorted order. */
+    MapNodeEntry entries[/*count*/];
+} MapNodeInfo;
+
+/**
+ * Cursor for walking the mappings of a map in order, without making a flat
+ * copy of a tree map. The map must remain referenced for as long as the
+ * cursor is in use.
+ */
+typedef struct {
+    /** Number of nodes in `nodes` (and `indexes`). */
+    zint depth;
+
+    /** Nodes from the root down to the parent of the current leaf. */
+    MapNodeInfo *nodes[CLS_MAX_MAP_TREE_HEIGHT];
+
+    /** Index of the child taken at each of `nodes`. */
+    zint indexes[CLS_MAX_MAP_TREE_HEIGHT];
+
+    /** Info of the current leaf. */
+    MapInfo *leaf;
+
+    /** Index of the next mapping of `leaf`. */
+    zint at;
+} MapCursor;
+
+/** Class value for the private class `MapNode`. */
+static zvalue CLS_MapNode = NULL;
+
 /**
  * Gets a pointer to the value's info.
  */
@@ -40,7 +101,14 @@ static MapInfo *getInfo(zvalue map) {
 }
 
 /**
- * Allocates a map of the given size.
+ * Gets a pointer to the node's info.
+ */
+static MapNodeInfo *getNodeInfo(zvalue node) {
+    return datPayload(node);
+}
+
+/**
+ * Allocates a flat map of the given size.
  */
 static zvalue allocMap(zint size) {
     zvalue result =
@@ -50,6 +118,29 @@ static zvalue allocMap(zint size) {
     return result;
 }
 
+/**
+ * Allocates a `MapNode` with the given number of children, and with the
+ * given entries. The `size` is calculated from the children.
+ */
+static zvalue makeNode(zint count, MapNodeEntry *entries) {
+    zvalue result = datAllocValue(CLS_MapNode,
+        sizeof(MapNodeInfo) + count * sizeof(MapNodeEntry));
+    MapNodeInfo *info = getNodeInfo(result);
+    zint size = 0;
+
+    for (zint i = 0; i < count; i++) {
+        zvalue child = entries[i].child;
+        size += (classOf(child) == CLS_Map)
+            ? getInfo(child)->size
+            : getNodeInfo(child)->size;
+    }
+
+    info->size = size;
+    info->count = count;
+    utilCpy(MapNodeEntry, info->entries, entries, count);
+    return result;
+}
+
 /**
  * Constructs and returns a map with the given mappings, without doing
  * any processing (checking or sorting) on the mappings.
@@ -62,6 +153,206 @@ static zvalue mapFromArrayUnchecked(zint size, zmapping *mappings) {
     return result;
 }
 
+/**
+ * Copies all the mappings under the given subtree (a flat map or a
+ * `MapNode`) into `result`, in order. Returns the number of mappings
+ * copied.
+ */
+static zint copyMappings(zmapping *result, zvalue subtree) {
+    if (classOf(subtree) == CLS_Map) {
+        MapInfo *info = getInfo(subtree);
+        utilCpy(zmapping, result, info->elems, info->size);
+        return info->size;
+    }
+
+    MapNodeInfo *info = getNodeInfo(subtree);
+    zint at = 0;
+
+    for (zint i = 0; i < info->count; i++) {
+        at += copyMappings(&result[at], info->entries[i].child);
+    }
+
+    return at;
+}
+
+/**
+ * Copies all the mappings of the given map into `result`, in key-sorted
+ * order.
+ */
+static void copyMap(zmapping *result, zvalue map) {
+    MapInfo *info = getInfo(map);
+
+    if (info->root == NULL) {
+        utilCpy(zmapping, result, info->elems, info->size);
+    } else {
+        copyMappings(result, info->root);
+    }
+}
+
+/**
+ * Gets the mappings of the given map, in key-sorted order. For a flat map,
+ * this is its own `elems`. For a tree map, this makes a flat copy, which
+ * remains valid for as long as the current frame. This is only for the
+ * benefit of code that needs the mappings as an array; everything else
+ * should use a `MapCursor`.
+ */
+static zmapping *getElems(zvalue map) {
+    MapInfo *info = getInfo(map);
+
+    if (info->root == NULL) {
+        return info->elems;
+    }
+
+    zvalue flat = allocMap(info->size);
+    zmapping *result = getInfo(flat)->elems;
+
+    copyMappings(result, info->root);
+    return result;
+}
+
+/**
+ * Sets up the given cursor to start at the first mapping of the given
+ * subtree (a flat map or a `MapNode`), taking the leftmost path down from
+ * it.
+ */
+static void cursorDescend(MapCursor *cursor, zvalue subtree) {
+    while (classOf(subtree) != CLS_Map) {
+        if (cursor->depth == CLS_MAX_MAP_TREE_HEIGHT) {
+            die("Map tree too tall.");
+        }
+
+        MapNodeInfo *info = getNodeInfo(subtree);
+
+        cursor->nodes[cursor->depth] = info;
+        cursor->indexes[cursor->depth] = 0;
+        cursor->depth++;
+        subtree = info->entries[0].child;
+    }
+
+    cursor->leaf = getInfo(subtree);
+    cursor->at = 0;
+}
+
+/**
+ * Sets up the given cursor to walk the given map from the start.
+ */
+static void cursorInit(MapCursor *cursor, zvalue map) {
+    zvalue root = getInfo(map)->root;
+
+    cursor->depth = 0;
+    cursorDescend(cursor, (root == NULL) ? map : root);
+}
+
+/**
+ * Gets a pointer to the next mapping from the given cursor, or `NULL` if
+ * there are no more mappings.
+ */
+static zmapping *cursorNext(MapCursor *cursor) {
+    while (cursor->at == cursor->leaf->size) {
+        // The current leaf is used up. Go up to the nearest node with
+        // another child, and then down to that child's first leaf.
+        for (;;) {
+            if (cursor->depth == 0) {
+                return NULL;
+            }
+
+            zint d = cursor->depth - 1;
+            MapNodeInfo *info = cursor->nodes[d];
+            zint next = cursor->indexes[d] + 1;
+
+            if (next < info->count) {
+                cursor->indexes[d] = next;
+                cursorDescend(cursor, info->entries[next].child);
+                break;
+            }
+
+            cursor->depth--;
+        }
+    }
+
+    zmapping *result = &cursor->leaf->elems[cursor->at];
+    cursor->at++;
+    return result;
+}
+
+/**
+ * Builds a tree from the given array of mappings, which must be sorted
+ * and free of duplicate keys. Returns the root of the tree, which is a
+ * flat map if there are few enough mappings.
+ */
+static zvalue treeFromArray(zint size, zmapping *mappings) {
+    if (size <= CLS_MAX_FLAT_MAP_SIZE) {
+        return mapFromArrayUnchecked(size, mappings);
+    }
+
+    // Make the leaves, spreading the mappings evenly among them.
+
+    zint count = (size + CLS_MAX_FLAT_MAP_SIZE - 1) / CLS_MAX_FLAT_MAP_SIZE;
+    MapNodeEntry entries[count];
+
+    for (zint i = 0, at = 0; i < count; i++) {
+        zint end = (size * (i + 1)) / count;
+        entries[i] = (MapNodeEntry) {
+            mappings[at].key,
+            mapFromArrayUnchecked(end - at, &mappings[at])
+        };
+        at = end;
+    }
+
+    // Make successive levels of nodes, until there's just one.
+
+    for (;;) {
+        zint newCount =
+            (count + CLS_MAX_MAP_NODE_CHILDREN - 1) / CLS_MAX_MAP_NODE_CHILDREN;
+
+        for (zint i = 0, at = 0; i < newCount; i++) {
+            zint end = (count * (i + 1)) / newCount;
+            entries[i] = (MapNodeEntry) {
+                entries[at].minKey,
+                makeNode(end - at, &entries[at])
+            };
+            at = end;
+        }
+
+        if (newCount == 1) {
+            return entries[0].child;
+        }
+
+        count = newCount;
+    }
+}
+
+/**
+ * Returns the map whose tree has the given root. If the root is a flat map
+ * then it is itself the result. If the root is a node with just one child,
+ * then the tree gets collapsed. If the tree is small enough, then the
+ * result is a flat map.
+ */
+static zvalue mapFromRoot(zvalue root) {
+    if (root == NULL) {
+        return EMPTY_MAP;
+    } else if (classOf(root) == CLS_Map) {
+        return root;
+    }
+
+    MapNodeInfo *nodeInfo = getNodeInfo(root);
+
+    if (nodeInfo->count == 1) {
+        return mapFromRoot(nodeInfo->entries[0].child);
+    } else if (nodeInfo->size <= CLS_MAX_FLAT_MAP_SIZE) {
+        zvalue result = allocMap(nodeInfo->size);
+        copyMappings(getInfo(result)->elems, root);
+        return result;
+    }
+
+    zvalue result = datAllocValue(CLS_Map, sizeof(MapInfo));
+    MapInfo *info = getInfo(result);
+
+    info->size = nodeInfo->size;
+    info->root = root;
+    return result;
+}
+
 /**
  * Allocates and returns a map with up to two mappings. This will return a
  * single-mapping map if the two keys are the same, in which case the *second*
@@ -82,8 +373,8 @@ static zvalue mapFrom2(zmapping elem1, zmapping elem2) {
 }
 
 /**
- * Given a map and its info struct, find the index of the given key. Returns
- * the index of the key if found. If not found, then this returns
+ * Given a flat map and its info struct, find the index of the given key.
+ * Returns the index of the key if found. If not found, then this returns
  * `~insertionIndex` (a negative number).
  */
 static zint mapFind(zvalue map, MapInfo *info, zvalue key) {
@@ -125,6 +416,78 @@ static zint mapFind(zvalue map, MapInfo *info, zvalue key) {
     return ~min;
 }
 
+/**
+ * Given a node's info, finds the index of the child under which the given
+ * key belongs.
+ */
+static zint nodeFind(MapNodeInfo *info, zvalue key) {
+    MapNodeEntry *entries = info->entries;
+
+    // The first entry's `minKey` is never consulted. Anything less than
+    // the second entry's `minKey` belongs under the first entry.
+    zint min = 1;
+    zint max = info->count - 1;
+
+    while (min <= max) {
+        zint guess = (min + max) / 2;
+        switch (cm_order(key, entries[guess].minKey)) {
+            case ZLESS: { max = guess - 1; break; }
+            case ZMORE: { min = guess + 1; break; }
+            default: {
+                return guess;
+            }
+        }
+    }
+
+    // `max` is the last entry whose `minKey` is less than `key`, or `0`.
+    return max;
+}
+
+/**
+ * Finds the flat map (either `map` itself, or a leaf of its tree) which
+ * would hold the given key.
+ */
+static zvalue findLeaf(zvalue map, zvalue key) {
+    zvalue subtree = getInfo(map)->root;
+
+    if (subtree == NULL) {
+        return map;
+    }
+
+    while (classOf(subtree) != CLS_Map) {
+        MapNodeInfo *info = getNodeInfo(subtree);
+        subtree = info->entries[nodeFind(info, key)].child;
+    }
+
+    return subtree;
+}
+
+/**
+ * Gets the first (least-keyed) mapping of the given non-empty subtree (a
+ * flat map or a `MapNode`).
+ */
+static zmapping firstMapping(zvalue subtree) {
+    while (classOf(subtree) != CLS_Map) {
+        subtree = getNodeInfo(subtree)->entries[0].child;
+    }
+
+    return getInfo(subtree)->elems[0];
+}
+
+/**
+ * Gets the last (greatest-keyed) mapping of the given non-empty subtree (a
+ * flat map or a `MapNode`).
+ */
+static zmapping lastMapping(zvalue subtree) {
+    while (classOf(subtree) != CLS_Map) {
+        MapNodeInfo *info = getNodeInfo(subtree);
+        subtree = info->entries[info->count - 1].child;
+    }
+
+    MapInfo *info = getInfo(subtree);
+    return info->elems[info->size - 1];
+}
+
 /**
  * Mapping comparison function, passed to standard library sorting
  * functions.
@@ -134,10 +497,10 @@ static int mappingOrder(const void *m1, const void *m2) {
 }
 
 /**
- * Put a new mapping into a map, either adding or replacing a key. Returns
- * a new map. `map` is assumed to be a valid map.
+ * Put a new mapping into a flat map, either adding or replacing a key.
+ * Returns a new flat map, which may be larger than the usual maximum size.
  */
-static zvalue putMapping(zvalue map, zmapping mapping) {
+static zvalue flatPut(zvalue map, zmapping mapping) {
     MapInfo *info = getInfo(map);
     zmapping *elems = info->elems;
     zint size = info->size;
@@ -176,6 +539,136 @@ static zvalue putMapping(zvalue map, zmapping mapping) {
     return result;
 }
 
+/**
+ * Puts a new mapping into the given subtree (a flat map or a `MapNode`).
+ * The replacement subtree is stored in `result[0]`. If the replacement had
+ * to be split in two, then its second half is stored in `result[1]`, and
+ * this function returns `true`.
+ */
+static bool subtreePut(zvalue subtree, zmapping mapping, MapNodeEntry *result) {
+    if (classOf(subtree) == CLS_Map) {
+        zvalue leaf = flatPut(subtree, mapping);
+        MapInfo *info = getInfo(leaf);
+
+        if (info->size <= CLS_MAX_FLAT_MAP_SIZE) {
+            result[0].child = leaf;
+            return false;
+        }
+
+        zint half = info->size / 2;
+        result[0].child = mapFromArrayUnchecked(half, info->elems);
+        result[1].minKey = info->elems[half].key;
+        result[1].child =
+            mapFromArrayUnchecked(info->size - half, &info->elems[half]);
+        return true;
+    }
+
+    MapNodeInfo *info = getNodeInfo(subtree);
+    zint count = info->count;
+    zint index = nodeFind(info, mapping.key);
+    MapNodeEntry entries[count + 1];
+    bool split = subtreePut(info->entries[index].child, mapping,
+        &entries[index]);
+
+    // Note: `info` remains valid, since `subtree` is referenced by the
+    // caller.
+    utilCpy(MapNodeEntry, entries, info->entries, index);
+    entries[index].minKey = info->entries[index].minKey;
+
+    if (split) {
+        utilCpy(MapNodeEntry, &entries[index + 2], &info->entries[index + 1],
+            count - index - 1);
+        count++;
+    } else {
+        utilCpy(MapNodeEntry, &entries[index + 1], &info->entries[index + 1],
+            count - index - 1);
+    }
+
+    if (count <= CLS_MAX_MAP_NODE_CHILDREN) {
+        result[0].child = makeNode(count, entries);
+        return false;
+    }
+
+    zint half = count / 2;
+    result[0].child = makeNode(half, entries);
+    result[1].minKey = entries[half].minKey;
+    result[1].child = makeNode(count - half, &entries[half]);
+    return true;
+}
+
+/**
+ * Put a new mapping into a map, either adding or replacing a key. Returns
+ * a new map. `map` is assumed to be a valid map.
+ */
+static zvalue putMapping(zvalue map, zmapping mapping) {
+    zvalue root = getInfo(map)->root;
+    MapNodeEntry entries[2];
+
+    if (root == NULL) {
+        root = map;
+    }
+
+    if (subtreePut(root, mapping, entries)) {
+        entries[0].minKey = mapping.key;  // Not significant for entry 0.
+        return mapFromRoot(makeNode(2, entries));
+    }
+
+    return mapFromRoot(entries[0].child);
+}
+
+/**
+ * Deletes the given key from the given subtree (a flat map or a
+ * `MapNode`). Returns the replacement subtree, or `NULL` if the result is
+ * empty. If `key` isn't in the subtree, this returns `subtree` itself.
+ */
+static zvalue subtreeDel(zvalue subtree, zvalue key) {
+    if (classOf(subtree) == CLS_Map) {
+        MapInfo *info = getInfo(subtree);
+        zint index = mapFind(subtree, info, key);
+
+        if (index < 0) {
+            return subtree;
+        } else if (info->size == 1) {
+            return NULL;
+        }
+
+        zvalue result = allocMap(info->size - 1);
+        zmapping *elems = getInfo(result)->elems;
+
+        utilCpy(zmapping, elems, info->elems, index);
+        utilCpy(zmapping, &elems[index], &info->elems[index + 1],
+            info->size - index - 1);
+        return result;
+    }
+
+    MapNodeInfo *info = getNodeInfo(subtree);
+    zint count = info->count;
+    zint index = nodeFind(info, key);
+    zvalue child = info->entries[index].child;
+    zvalue newChild = subtreeDel(child, key);
+
+    if (newChild == child) {
+        return subtree;
+    }
+
+    MapNodeEntry entries[count];
+    utilCpy(MapNodeEntry, entries, info->entries, count);
+
+    if (newChild != NULL) {
+        entries[index].child = newChild;
+    } else if (count == 1) {
+        return NULL;
+    } else {
+        // Drop the emptied child. This leaves the separators valid, since
+        // no keys were in the range that the child covered.
+        utilCpy(MapNodeEntry, &entries[index], &entries[index + 1],
+            count - index - 1);
+        count--;
+    }
+
+    return makeNode(count, entries);
+}
+
 
 //
 // Exported Definitions
@@ -221,7 +714,7 @@ zvalue mapFromArray(zint size, zmapping *mappings) {
     }
 
     // Allocate, populate, and return the result.
-    return mapFromArrayUnchecked(at, mappings);
+    return mapFromRoot(treeFromArray(at, mappings));
 }
 
 // Documented in header.
@@ -233,8 +726,7 @@ zvalue mapFromMapping(zmapping mapping) {
 zassoc zassocFromMap(zvalue map) {
     assertHasClass(map, CLS_Map);
 
-    MapInfo *info = getInfo(map);
-    return (zassoc) {info->size, info->elems};
+    return (zassoc) {getInfo(map)->size, getElems(map)};
 }
 
 
@@ -299,8 +791,7 @@ METH_IMPL_1(Map, castToward, cls) {
     MapInfo *info = getInfo(ths);
 
     if (cmpEq(cls, CLS_SymbolTable)) {
-        zint size = info->size;
-        return symtabFromZassoc((zassoc) {info->size, info->elems});
+        return symtabFromZassoc((zassoc) {info->size, getElems(ths)});
     } else if (typeAccepts(cls, ths)) {
         return ths;
     }
@@ -355,29 +846,60 @@ METH_IMPL_rest(Map, cat, args) {
         }
     }
 
+    if ((thsInfo->root != NULL) && ((size - thsSize) < thsSize)) {
+        // `ths` is a tree, and relatively few mappings are being added to
+        // it. Add them one at a time, which shares most of the tree.
+        zvalue result = ths;
+
+        for (zint i = 0; i < args.size; i++) {
+            MapCursor cursor;
+            cursorInit(&cursor, maps[i]);
+
+            for (;;) {
+                zmapping *one = cursorNext(&cursor);
+
+                if (one == NULL) {
+                    break;
+                }
+
+                result = putMapping(result, *one);
+            }
+        }
+
+        return result;
+    }
+
     // The general case.
 
-    zmapping elems[size];
+    zmapping *elems = utilAlloc(size * sizeof(zmapping));
     zint at = thsSize;
-    utilCpy(zmapping, elems, thsInfo->elems, thsSize);
+    copyMap(elems, ths);
     for (zint i = 0; i < args.size; i++) {
-        zint oneSize = infos[i]->size;
-        utilCpy(zmapping, &elems[at], infos[i]->elems, oneSize);
-        at += oneSize;
+        copyMap(&elems[at], maps[i]);
+        at += infos[i]->size;
     }
 
-    return mapFromArray(size, elems);
+    zvalue result = mapFromArray(size, elems);
+    utilFree(elems);
+    return result;
 }
 
 // Documented in spec.
 METH_IMPL_0_opt(Map, collect, function) {
-    MapInfo *info = getInfo(ths);
-    zint size = info->size;
-    zvalue result[size];
+    zvalue *result = utilAlloc(getInfo(ths)->size * sizeof(zvalue));
     zint at = 0;
+    MapCursor cursor;
 
-    for (zint i = 0; i < size; i++) {
-        zvalue elem = mapFromMapping(info->elems[i]);
+    cursorInit(&cursor, ths);
+
+    for (;;) {
+        zmapping *mapping = cursorNext(&cursor);
+
+        if (mapping == NULL) {
+            break;
+        }
+
+        zvalue elem = mapFromMapping(*mapping);
         zvalue one = (function == NULL)
             ? elem
             : FUN_CALL(function, elem);
@@ -388,7 +910,9 @@ METH_IMPL_0_opt(Map, collect, function) {
         }
     }
 
-    return listFromZarray((zarray) {at, result});
+    zvalue resultList = listFromZarray((zarray) {at, result});
+    utilFree(result);
+    return resultList;
 }
 
 // Documented in spec.
@@ -403,12 +927,15 @@ METH_IMPL_1(Map, crossEq, other) {
         return NULL;
     }
 
-    zmapping *elems1 = info1->elems;
-    zmapping *elems2 = info2->elems;
+    MapCursor cursor1;
+    MapCursor cursor2;
+
+    cursorInit(&cursor1, ths);
+    cursorInit(&cursor2, other);
 
     for (zint i = 0; i < size1; i++) {
-        zmapping *e1 = &elems1[i];
-        zmapping *e2 = &elems2[i];
+        zmapping *e1 = cursorNext(&cursor1);
+        zmapping *e2 = cursorNext(&cursor2);
         if (!(cmpEq(e1->key, e2->key) && cmpEq(e1->value, e2->value))) {
             return NULL;
         }
@@ -422,14 +949,18 @@ METH_IMPL_1(Map, crossOrder, other) {
     assertHasClass(other, CLS_Map);  // Note: Not guaranteed to be a `Map`.
     MapInfo *info1 = getInfo(ths);
     MapInfo *info2 = getInfo(other);
-    zmapping *e1 = info1->elems;
-    zmapping *e2 = info2->elems;
     zint size1 = info1->size;
     zint size2 = info2->size;
     zint size = (size1 < size2) ? size1 : size2;
+    MapCursor cursor1;
+    MapCursor cursor2;
+
+    cursorInit(&cursor1, ths);
+    cursorInit(&cursor2, other);
 
     for (zint i = 0; i < size; i++) {
-        zorder result = cm_order(e1[i].key, e2[i].key);
+        zorder result =
+            cm_order(cursorNext(&cursor1)->key, cursorNext(&cursor2)->key);
         if (result != ZSAME) {
             return symbolFromZorder(result);
         }
@@ -441,8 +972,14 @@ METH_IMPL_1(Map, crossOrder, other) {
         return SYM(more);
     }
 
+    // The keys are all the same. Go back to the start, and compare values.
+
+    cursorInit(&cursor1, ths);
+    cursorInit(&cursor2, other);
+
     for (zint i = 0; i < size; i++) {
-        zorder result = cm_order(e1[i].value, e2[i].value);
+        zorder result =
+            cm_order(cursorNext(&cursor1)->value, cursorNext(&cursor2)->value);
         if (result != ZSAME) {
             return symbolFromZorder(result);
         }
@@ -455,7 +992,6 @@ METH_IMPL_1(Map, crossOrder, other) {
 METH_IMPL_rest(Map, del, keys) {
     MapInfo *info = getInfo(ths);
     zint size = info->size;
-    zmapping elems[size];
     bool any = false;
 
     if ((keys.size == 0) || (size == 0)) {
@@ -464,6 +1000,18 @@ METH_IMPL_rest(Map, del, keys) {
         return ths;
     }
 
+    if (info->root != NULL) {
+        zvalue root = info->root;
+
+        for (zint i = 0; (i < keys.size) && (root != NULL); i++) {
+            root = subtreeDel(root, keys.elems[i]);
+        }
+
+        return (root == info->root) ? ths : mapFromRoot(root);
+    }
+
+    zmapping elems[size];
+
     // Make a local copy of the original mappings.
     utilCpy(zmapping, elems, info->elems, size);
 
@@ -523,16 +1071,29 @@ METH_IMPL_0(Map, fetch) {
 // Documented in spec.
 METH_IMPL_0_opt(Map, forEach, function) {
     MapInfo *info = getInfo(ths);
-    zint size = info->size;
     zvalue result = NULL;
+    MapCursor cursor;
 
     if (function == NULL) {
         // Without a function, this method just returns the last element.
-        return (size == 0) ? NULL : mapFromMapping(info->elems[size - 1]);
+        if (info->size == 0) {
+            return NULL;
+        }
+
+        return mapFromMapping(
+            lastMapping((info->root == NULL) ? ths : info->root));
     }
 
-    for (zint i = 0; i < size; i++) {
-        zvalue v = FUN_CALL(function, mapFromMapping(info->elems[i]));
+    cursorInit(&cursor, ths);
+
+    for (;;) {
+        zmapping *one = cursorNext(&cursor);
+
+        if (one == NULL) {
+            break;
+        }
+
+        zvalue v = FUN_CALL(function, mapFromMapping(*one));
         if (v != NULL) {
             result = v;
         }
@@ -547,6 +1108,11 @@ METH_IMPL_0(Map, gcMark) {
     zint size = info->size;
     zmapping *elems = info->elems;
 
+    if (info->root != NULL) {
+        datMark(info->root);
+        return NULL;
+    }
+
     for (zint i = 0; i < size; i++) {
         datMark(elems[i].key);
         datMark(elems[i].value);
@@ -557,8 +1123,9 @@ METH_IMPL_0(Map, gcMark) {
 
 // Documented in spec.
 METH_IMPL_1(Map, get, key) {
-    MapInfo *info = getInfo(ths);
-    zint index = mapFind(ths, info, key);
+    zvalue leaf = findLeaf(ths, key);
+    MapInfo *info = getInfo(leaf);
+    zint index = mapFind(leaf, info, key);
     return (index < 0) ? NULL : info->elems[index].value;
 }
 
@@ -591,16 +1158,19 @@ METH_IMPL_0(Map, get_value) {
 
 // Documented in spec.
 METH_IMPL_0(Map, keyList) {
-    MapInfo *info = getInfo(ths);
-    zint size = info->size;
-    zmapping *elems = info->elems;
-    zvalue arr[size];
+    zint size = getInfo(ths)->size;
+    zvalue *arr = utilAlloc(size * sizeof(zvalue));
+    MapCursor cursor;
+
+    cursorInit(&cursor, ths);
 
     for (zint i = 0; i < size; i++) {
-        arr[i] = elems[i].key;
+        arr[i] = cursorNext(&cursor)->key;
     }
 
-    return listFromZarray((zarray) {size, arr});
+    zvalue result = listFromZarray((zarray) {size, arr});
+    utilFree(arr);
+    return result;
 }
 
 // Documented in spec.
@@ -621,6 +1191,12 @@ METH_IMPL_1(Map, nextValue, box) {
         default: {
             // Make a mapping for the first element, yield it, and return
             // a map of the remainder.
+            if (info->root != NULL) {
+                zmapping first = firstMapping(info->root);
+                cm_store(box, mapFromMapping(first));
+                return mapFromRoot(subtreeDel(info->root, first.key));
+            }
+
             zmapping *elems = info->elems;
             zvalue mapping = mapFromMapping(elems[0]);
             cm_store(box, mapping);
@@ -631,16 +1207,31 @@ METH_IMPL_1(Map, nextValue, box) {
 
 // Documented in spec.
 METH_IMPL_0(Map, valueList) {
-    MapInfo *info = getInfo(ths);
-    zint size = info->size;
-    zmapping *elems = info->elems;
-    zvalue arr[size];
+    zint size = getInfo(ths)->size;
+    zvalue *arr = utilAlloc(size * sizeof(zvalue));
+    MapCursor cursor;
+
+    cursorInit(&cursor, ths);
 
     for (zint i = 0; i < size; i++) {
-        arr[i] = elems[i].value;
+        arr[i] = cursorNext(&cursor)->value;
+    }
+
+    zvalue result = listFromZarray((zarray) {size, arr});
+    utilFree(arr);
+    return result;
+}
+
+// Documented in header.
+METH_IMPL_0(MapNode, gcMark) {
+    MapNodeInfo *info = getNodeInfo(ths);
+
+    for (zint i = 0; i < info->count; i++) {
+        datMark(info->entries[i].minKey);
+        datMark(info->entries[i].child);
     }
 
-    return listFromZarray((zarray) {size, arr});
+    return NULL;
 }
 
 /** Initializes the module. */
@@ -670,6 +1261,15 @@ MOD_INIT(Map) {
             METH_BIND(Map, nextValue),
             METH_BIND(Map, valueList)));
 
+    classSetThreadSafeGcMark(CLS_Map);
+
+    CLS_MapNode = makeCoreClass(SYM(MapNode), CLS_Core,
+        NULL,
+        METH_TABLE(
+            METH_BIND(MapNode, gcMark)));
+
+    classSetThreadSafeGcMark(CLS_MapNode);
+
     EMPTY_MAP = datImmortalize(allocMap(0));
 }
 
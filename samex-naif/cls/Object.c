@@ -65,6 +65,8 @@ METH_IMPL_0_opt(Object, new, data) {
  * that's bound as the instance method for the `access` symbol.
  */
 METH_IMPL_0_opt(Object, access, key) {
+    assertHasClass(ths, CLS_Object);
+
     zvalue data = getInfo(ths)->data;
     return (key == NULL) ? data : symtabGet(data, key);
 }
@@ -156,6 +158,8 @@ MOD_INIT(Object) {
             METH_BIND(Object, crossEq),
             METH_BIND(Object, crossOrder),
             METH_BIND(Object, gcMark)));
+
+    classSetThreadSafeGcMark(CLS_Object);
 }
 
 // Documented in header.
@@ -17,6 +17,13 @@ enum {
     /** Whether to be paranoid about values in collections / records. */
     CLS_CONSTRUCTION_PARANOIA = false,
 
+    /**
+     * Maximum size of a map which is represented as a flat array of
+     * mappings. Larger maps are represented as trees, whose leaves are flat
+     * maps of up to this size.
+     */
+    CLS_MAX_FLAT_MAP_SIZE = 32,
+
     /**
      * Maximum number of items that can be `collect`ed or `filter`ed out
      * of a generator, period.
@@ -27,7 +34,18 @@ enum {
      * Maximum number of items that can be `collect`ed or `filter`ed out
      * of a generator, without resorting to heavyweight memory operations.
      */
-    CLS_MAX_GENERATOR_ITEMS_SOFT = 1000
+    CLS_MAX_GENERATOR_ITEMS_SOFT = 1000,
+
+    /** Maximum number of children of an interior node of a tree map. */
+    CLS_MAX_MAP_NODE_CHILDREN = 32,
+
+    /**
+     * Maximum height of a tree map. A tree only gets taller when its root
+     * splits, and each level takes at least half a node's worth of splits
+     * of the level below it, so a tree this tall would take more insertions
+     * than could ever be performed.
+     */
+    CLS_MAX_MAP_TREE_HEIGHT = 20
 };
 
 #endif
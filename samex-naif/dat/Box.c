@@ -116,6 +116,8 @@ MOD_INIT(Box) {
             METH_BIND(Box, forEach),
             METH_BIND(Box, gcMark),
             METH_BIND(Box, nextValue)));
+
+    classSetThreadSafeGcMark(CLS_Box);
 }
 
 // Documented in header.
@@ -134,6 +136,7 @@ CMETH_IMPL_0_opt(Cell, new, value) {
 // Documented in spec.
 METH_IMPL_0_opt(Cell, store, value) {
     getInfo(ths)->value = value;
+    datWriteBarrier(ths);
     return value;
 }
 
@@ -170,6 +173,7 @@ METH_IMPL_0(Lazy, fetch) {
     if (info->canStore) {
         info->value = FUN_CALL(info->value);
         info->canStore = false;
+        datWriteBarrier(ths);
     }
 
     return info->value;
@@ -244,6 +248,7 @@ METH_IMPL_0_opt(Promise, store, value) {
 
     info->canStore = false;
     info->value = value;
+    datWriteBarrier(ths);
     return value;
 }
 
@@ -10,6 +10,7 @@
 #include "type/String.h"
 #include "type/Value.h"
 #include "type/define.h"
+#include "util.h"
 
 #include "impl.h"
 
@@ -31,9 +32,21 @@ typedef struct {
     /** C function to call. */
     zfunction function;
 
+    /**
+     * C function to call when called as a method, if any. See
+     * `makeBuiltinMethod()`.
+     */
+    zmethod method;
+
     /** The count of mutable slots of state. Always `>= 0`. */
     zint stateSize;
 
+    /**
+     * Whether the function is safe to call from multiple threads at once.
+     * See `classSetThreadSafeGcMark()`.
+     */
+    bool threadSafe;
+
     /** The builtin's name, if any. Used when producing stack traces. */
     zvalue name;
 
@@ -48,6 +61,20 @@ static BuiltinInfo *getInfo(zvalue builtin) {
     return datPayload(builtin);
 }
 
+/**
+ * Checks the given argument count against the restrictions of the given
+ * builtin, dying if it is out of range.
+ */
+static void checkArgCount(BuiltinInfo *info, zint size) {
+    if (size < info->minArgs) {
+        die("Too few arguments for builtin call: %lld, min %lld",
+            size, info->minArgs);
+    } else if (size > info->maxArgs) {
+        die("Too many arguments for builtin call: %lld, max %lld",
+            size, info->maxArgs);
+    }
+}
+
 
 //
 // Module Definitions
@@ -57,15 +84,37 @@ static BuiltinInfo *getInfo(zvalue builtin) {
 zvalue builtinCall(zvalue builtin, zarray args) {
     BuiltinInfo *info = getInfo(builtin);
 
-    if (args.size < info->minArgs) {
-        die("Too few arguments for builtin call: %lld, min %lld",
-            args.size, info->minArgs);
-    } else if (args.size > info->maxArgs) {
-        die("Too many arguments for builtin call: %lld, max %lld",
-            args.size, info->maxArgs);
+    checkArgCount(info, args.size);
+    return info->function(builtin, args);
+}
+
+// Documented in header.
+zvalue builtinCallMethod(zvalue builtin, zvalue ths, zarray args) {
+    BuiltinInfo *info = getInfo(builtin);
+    zint size = args.size + 1;
+
+    checkArgCount(info, size);
+
+    if (info->method != NULL) {
+        return info->method(builtin, ths, args);
     }
 
-    return info->function(builtin, args);
+    // No method entry point, so prepend `ths` as a new first argument.
+    zvalue newArgs[size];
+    newArgs[0] = ths;
+    utilCpy(zvalue, &newArgs[1], args.elems, args.size);
+
+    return info->function(builtin, (zarray) {size, newArgs});
+}
+
+// Documented in header.
+bool builtinIsThreadSafe(zvalue builtin) {
+    return getInfo(builtin)->threadSafe;
+}
+
+// Documented in header.
+void builtinSetThreadSafe(zvalue builtin) {
+    getInfo(builtin)->threadSafe = true;
 }
 
 
@@ -96,12 +145,26 @@ zvalue makeBuiltin(zint minArgs, zint maxArgs, zfunction function,
     info->minArgs = minArgs;
     info->maxArgs = (maxArgs != -1) ? maxArgs : INT64_MAX;
     info->function = function;
+    info->method = NULL;
     info->stateSize = stateSize;
     info->name = name;
 
     return result;
 }
 
+// Documented in header.
+zvalue makeBuiltinMethod(zint minArgs, zint maxArgs, zfunction function,
+        zmethod method, zint stateSize, zvalue name) {
+    if (minArgs < 1) {
+        die("Invalid `minArgs` for method: %lld", minArgs);
+    }
+
+    zvalue result = makeBuiltin(minArgs, maxArgs, function, stateSize, name);
+
+    getInfo(result)->method = method;
+    return result;
+}
+
 // Documented in header.
 BuiltinState builtinGetState(zvalue builtin) {
     assertHasClass(builtin, CLS_Builtin);
@@ -154,6 +217,8 @@ void bindMethodsForBuiltin(void) {
             METH_BIND(Builtin, call),
             METH_BIND(Builtin, debugSymbol),
             METH_BIND(Builtin, gcMark)));
+
+    classSetThreadSafeGcMark(CLS_Builtin);
 }
 
 /** Initializes the module. */
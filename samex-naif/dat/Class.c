@@ -28,6 +28,16 @@ typedef struct {
     /** Parent class. Only allowed to be `NULL` for `Value`. */
     zvalue parent;
 
+    /** Number of ancestors the class has. `0` for `Value`. */
+    zint depth;
+
+    /**
+     * Ancestor "display," which is used to make subclass checks take
+     * constant time. Element `n` is the ancestor of the class whose `depth`
+     * is `n`, for as many as fit. Element `depth` is the class itself.
+     */
+    zvalue display[DAT_CLASS_DISPLAY_SIZE];
+
     /** Name of the class, as a symbol. */
     zvalue name;
 
@@ -38,12 +48,50 @@ typedef struct {
     bool isCore;
 
     /**
-     * Bindings from method symbols to functions, keyed off of symbol
-     * index number.
+     * Methods bound directly by this class (not including inherited ones),
+     * as a symbol table from names to functions. `NULL` if the class binds
+     * no methods of its own.
+     */
+    zvalue methods;
+
+    /**
+     * The class's `gcMark` method (which may be inherited), if any. This is
+     * kept separately, because it gets looked up during gc, which can
+     * happen on multiple threads at once and so can't use the method cache.
      */
-    zvalue methods[DAT_MAX_SYMBOLS];
+    zvalue gcMark;
 } ClassInfo;
 
+/**
+ * Entry in the method cache.
+ */
+typedef struct {
+    /** The class. `NULL` indicates an empty entry. */
+    zvalue cls;
+
+    /** Method name, as a symbol index. */
+    zint index;
+
+    /** The bound function, or `NULL` if the method is unbound. */
+    zvalue function;
+} MethodCacheEntry;
+
+/**
+ * Global method cache, keyed by class and method name. This is
+ * direct-mapped. It holds its classes weakly, so it gets cleared on every
+ * gc (see `classClearMethodCache()`). It also gets cleared whenever methods
+ * are bound.
+ */
+static MethodCacheEntry methodCache[DAT_METHOD_CACHE_SIZE];
+
+/**
+ * Method cache epoch. This gets incremented every time the method cache
+ * is cleared, and inline caches (`zcallCache`s) are only valid when they
+ * match it. It starts out at `1`, so that zero-initialized inline caches
+ * are never valid.
+ */
+static zint methodCacheEpoch = 1;
+
 
 /**
  * Gets a pointer to the value's info.
@@ -63,20 +111,63 @@ static bool classEqUnchecked(zvalue cls1, zvalue cls2) {
     return (cls1 == cls2);
 }
 
+/**
+ * Returns whether `ancestor` is `cls` or one of its superclasses. Does
+ * *not* check to see if the arguments are actually classes.
+ */
+static bool hasAncestorUnchecked(zvalue cls, zvalue ancestor) {
+    ClassInfo *info = getInfo(cls);
+    zint depth = getInfo(ancestor)->depth;
+
+    if (depth > info->depth) {
+        return false;
+    } else if (depth < DAT_CLASS_DISPLAY_SIZE) {
+        return classEqUnchecked(info->display[depth], ancestor);
+    }
+
+    // The ancestor is too deep to be in the display. Walk up to its depth.
+    for (zint i = info->depth; i > depth; i--) {
+        cls = getInfo(cls)->parent;
+    }
+
+    return classEqUnchecked(cls, ancestor);
+}
+
 /**
  * Asserts that `value` is an instance of `Class` or a subclass thereof.
  */
 static void assertIsClass(zvalue value) {
-    zvalue cls = classOf(value);
+    if (!hasAncestorUnchecked(classOf(value), CLS_Class)) {
+        die("Expected a class; got %s.", cm_debugString(value));
+    }
+}
+
+/**
+ * Sets the parent of the given class, and sets up its depth and display
+ * accordingly. `parent` must already have been set up, or be `NULL`.
+ */
+static void setParent(zvalue cls, zvalue parent) {
+    ClassInfo *info = getInfo(cls);
 
-    while (cls != NULL) {
-        if (classEqUnchecked(cls, CLS_Class)) {
-            return;
+    info->parent = parent;
+
+    if (parent == NULL) {
+        info->depth = 0;
+    } else {
+        ClassInfo *parentInfo = getInfo(parent);
+        zint size = parentInfo->depth + 1;
+
+        if (size > DAT_CLASS_DISPLAY_SIZE) {
+            size = DAT_CLASS_DISPLAY_SIZE;
         }
-        cls = getInfo(cls)->parent;
+
+        info->depth = parentInfo->depth + 1;
+        utilCpy(zvalue, info->display, parentInfo->display, size);
     }
 
-    die("Expected a class; got %s.", cm_debugString(value));
+    if (info->depth < DAT_CLASS_DISPLAY_SIZE) {
+        info->display[info->depth] = cls;
+    }
 }
 
 /**
@@ -128,10 +219,10 @@ static zvalue makeClassPair(zvalue name, zvalue parent, bool isCore) {
         metaInfo->name = symbolCat(SYM(meta_), name);
     }
 
-    if (parent != NULL) {
-        clsInfo->parent = parent;
-        metaInfo->parent = parent->cls;
-    }
+    // When `parent` is `NULL`, this results in a depth of `0`. That gets
+    // fixed up during bootstrap, for classes other than `Value`.
+    setParent(cls, parent);
+    setParent(metacls, (parent == NULL) ? NULL : parent->cls);
 
     if (isCore) {
         datImmortalize(cls);
@@ -150,20 +241,32 @@ static void initEarlyClass(zvalue cls, zvalue name) {
 }
 
 /**
- * Performs method "reinheritance" on the given class, copying any parent
- * methods that aren't already overridden by the given class. See call site
- * for more info.
+ * Finds a method on a class, without using the method cache. This walks
+ * up the superclass chain, looking in the table of methods bound directly
+ * by each class.
  */
-static void reinheritMethods(zvalue cls) {
-    ClassInfo *info = getInfo(cls);
-    ClassInfo *parentInfo = getInfo(info->parent);
-
-    for (zint i = 0; i < DAT_MAX_SYMBOLS; i++) {
-        zvalue one = parentInfo->methods[i];
-        if ((one != NULL) && (info->methods[i] == NULL)) {
-            info->methods[i] = one;
+static zvalue findMethodUncached(zvalue cls, zvalue name) {
+    for (/*cls*/; cls != NULL; cls = getInfo(cls)->parent) {
+        zvalue methods = getInfo(cls)->methods;
+
+        if (methods != NULL) {
+            zvalue result = symtabGetUnchecked(methods, name);
+            if (result != NULL) {
+                return result;
+            }
         }
     }
+
+    return NULL;
+}
+
+/**
+ * Sets the `gcMark` of the given class based on its current (possibly
+ * inherited) method bindings. See call sites for more info.
+ */
+static void updateGcMark(zvalue cls) {
+    getInfo(cls)->gcMark = findMethodUncached(cls, SYM(gcMark));
+    datWriteBarrier(cls);
 }
 
 /**
@@ -179,15 +282,7 @@ static bool isCoreClass(ClassInfo *info) {
  * is in fact a class.
  */
 static bool acceptsUnchecked(zvalue cls, zvalue value) {
-    for (zvalue valueCls = classOf(value);
-            valueCls != NULL;
-            valueCls = getInfo(valueCls)->parent) {
-        if (classEqUnchecked(valueCls, cls)) {
-            return true;
-        }
-    }
-
-    return false;
+    return hasAncestorUnchecked(classOf(value), cls);
 }
 
 /**
@@ -195,23 +290,11 @@ static bool acceptsUnchecked(zvalue cls, zvalue value) {
  * or instance).
  */
 static void bindOne(zvalue cls, zvalue methods) {
-    ClassInfo *info = getInfo(cls);
-    zint size = (methods == NULL) ? 0 : symtabSize(methods);
-
-    if (info->parent != NULL) {
-        // Initialize the method table with whatever the parent binds.
-        utilCpy(zvalue, info->methods, getInfo(info->parent)->methods,
-            DAT_MAX_SYMBOLS);
+    if ((methods != NULL) && (symtabSize(methods) != 0)) {
+        getInfo(cls)->methods = methods;
     }
 
-    if (size != 0) {
-        zmapping arr[size];
-        arrayFromSymtab(arr, methods);
-        for (zint i = 0; i < size; i++) {
-            zint index = symbolIndex(arr[i].key);
-            info->methods[index] = arr[i].value;
-        }
-    }
+    updateGcMark(cls);
 }
 
 
@@ -224,20 +307,83 @@ void classBindMethods(zvalue cls, zvalue classMethods,
         zvalue instanceMethods) {
     bindOne(cls->cls, classMethods);
     bindOne(cls, instanceMethods);
+
+    // Cached lookups involving this class may no longer be valid. This
+    // includes lookups on subclasses, which can happen during bootstrap.
+    classClearMethodCache();
+}
+
+// Documented in header.
+void classClearMethodCache(void) {
+    utilZero(methodCache);
+    methodCacheEpoch++;
+}
+
+// Documented in header.
+zvalue classFindMethodCached(zcallCache *cache, zvalue cls, zvalue name) {
+    if ((cache->epoch == methodCacheEpoch) && (cache->name == name)) {
+        for (zint i = 0; i < cache->size; i++) {
+            if (cache->classes[i] == cls) {
+                return cache->functions[i];
+            }
+        }
+    } else {
+        cache->epoch = methodCacheEpoch;
+        cache->name = name;
+        cache->size = 0;
+    }
+
+    zvalue result = classFindMethodUnchecked(cls, symbolIndex(name));
+
+    // Once the cache is full, the last entry gets replaced. This keeps
+    // the other entries stable for sites which are (only slightly)
+    // megamorphic.
+    zint at = cache->size;
+    if (at == DAT_CALL_CACHE_SIZE) {
+        at--;
+    } else {
+        cache->size++;
+    }
+
+    cache->classes[at] = cls;
+    cache->functions[at] = result;
+    return result;
 }
 
 // Documented in header.
 zvalue classFindMethodUnchecked(zvalue cls, zint index) {
-    return getInfo(cls)->methods[index];
+    uintptr_t hash = ((uintptr_t) cls / DAT_GRANULE_SIZE) ^ (index * 31);
+    MethodCacheEntry *entry =
+        &methodCache[hash & (DAT_METHOD_CACHE_SIZE - 1)];
+
+    if ((entry->cls != cls) || (entry->index != index)) {
+        *entry = (MethodCacheEntry) {
+            .cls = cls,
+            .index = index,
+            .function = findMethodUncached(cls, symbolFromIndex(index))
+        };
+    }
+
+    return entry->function;
+}
+
+// Documented in header.
+zvalue classNameUnchecked(zvalue cls) {
+    return getInfo(cls)->name;
+}
+
+// Documented in header.
+bool classHasThreadSafeGcMark(zvalue cls) {
+    zvalue func = getInfo(cls)->gcMark;
+    return (func == NULL) || builtinIsThreadSafe(func);
 }
 
 // Documented in header.
 void callGcMark(zvalue value) {
-    ClassInfo *info = getInfo(value->cls);
-    zvalue func = info->methods[SYMIDX(gcMark)];
+    zvalue func = getInfo(value->cls)->gcMark;
 
     if (func != NULL) {
-        builtinCall(func, (zarray) {1, &value});
+        builtinCallMethod(func, value, EMPTY_ZARRAY);
     }
 }
 
@@ -252,7 +398,7 @@ extern void assertHasClass(zvalue value, zvalue cls);
 // Documented in header.
 void assertHasClass0(zvalue value, zvalue cls) {
     assertIsClass(cls);
-    if (acceptsUnchecked(cls, value)) {
+    if (!acceptsUnchecked(cls, value)) {
         die("Expected class %s; got %s of class %s.",
             cm_debugString(cls), cm_debugString(value),
             cm_debugString(classOf(value)));
@@ -289,6 +435,20 @@ zvalue makeCoreClass(zvalue name, zvalue parent,
     return result;
 }
 
+// Documented in header.
+void classSetThreadSafeGcMark(zvalue cls) {
+    assertIsClass(cls);
+
+    zvalue func = getInfo(cls)->gcMark;
+
+    if (func == NULL) {
+        die("Class has no `gcMark` method: %s", cm_debugString(cls));
+    }
+
+    assertHasClass(func, CLS_Builtin);
+    builtinSetThreadSafe(func);
+}
+
 // Documented in header.
 zvalue typeAccepts(zvalue cls, zvalue value) {
     return (METH_CALL(cls, accepts, value) != NULL) ? value : NULL;
@@ -406,10 +566,8 @@ METH_IMPL_0(Class, gcMark) {
 
     datMark(info->parent);
     datMark(info->name);
-
-    for (zint i = 0; i < DAT_MAX_SYMBOLS; i++) {
-        datMark(info->methods[i]);
-    }
+    datMark(info->methods);
+    datMark(info->gcMark);
 
     return NULL;
 }
@@ -493,12 +651,13 @@ MOD_INIT(objectModel) {
     // we assign it explicitly, immediately below.
     CLS_Value = makeClassPair(NULL, NULL, true);
 
-    // Finally, set up the missing the heritage relationships.
-    getInfo(CLS_Value->cls)->parent = CLS_Class;
-    getInfo(CLS_Class)->parent = CLS_Value;
-    getInfo(CLS_Class->cls)->parent = CLS_Value->cls;
-    getInfo(CLS_Metaclass)->parent = CLS_Class;
-    getInfo(CLS_Metaclass->cls)->parent = CLS_Class->cls;
+    // Finally, set up the missing the heritage relationships. The order
+    // matters, as each class's display is built from its parent's.
+    setParent(CLS_Class, CLS_Value);
+    setParent(CLS_Metaclass, CLS_Class);
+    setParent(CLS_Value->cls, CLS_Class);
+    setParent(CLS_Class->cls, CLS_Value->cls);
+    setParent(CLS_Metaclass->cls, CLS_Class->cls);
 
     // With the "knotted" classes taken care of, now do the initial
     // special-case setup of `Core` and `Symbol`. These are required for
@@ -537,11 +696,12 @@ MOD_INIT(objectModel) {
 
     // These calls are needed because of the circular nature of classes: All
     // of these classes' metaclasses got bound before `Class` itself got its
-    // methods bound, and so we need to "re-percolate" `Class`'s method
-    // bindings down through them.
-    reinheritMethods(CLS_Value->cls);
-    reinheritMethods(CLS_Class->cls);
-    reinheritMethods(CLS_Metaclass->cls);
+    // methods bound, and so we need to "re-percolate" `Class`'s `gcMark`
+    // binding down through them. (Other methods get looked up through the
+    // superclass chain as needed, and so don't need this treatment.)
+    updateGcMark(CLS_Value->cls);
+    updateGcMark(CLS_Class->cls);
+    updateGcMark(CLS_Metaclass->cls);
 
     bindMethodsForCore();
     bindMethodsForSymbol();
@@ -568,6 +728,8 @@ void bindMethodsForClass(void) {
             METH_BIND(Class, get_parent),
             METH_BIND(Class, perOrder)));
 
+    classSetThreadSafeGcMark(CLS_Class);
+
     // `Metaclass` binds no methods itself. TODO: It probably wants at least
     // a couple.
     classBindMethods(CLS_Metaclass,
@@ -18,6 +18,9 @@ zvalue cmpEq(zvalue value, zvalue other) {
         die("Shouldn't happen: NULL argument passed to `cmpEq`.");
     } else if (value == other) {
         return value;
+    } else if (datIsImmediateInt(value) && datIsImmediateInt(other)) {
+        // Immediate ints are equal only if they're identical.
+        return NULL;
     } else if (haveSameClass(value, other)) {
         return (METH_CALL(value, crossEq, other) == NULL) ? NULL : value;
     } else {
@@ -42,6 +45,12 @@ zvalue cmpOrder(zvalue value, zvalue other) {
         die("Shouldn't happen: NULL argument passed to `cmpOrder`.");
     } else if (value == other) {
         return SYM(same);
+    } else if (datIsImmediateInt(value) && datIsImmediateInt(other)) {
+        // The encoding of immediate ints preserves their order, so there's
+        // no need to decode them.
+        return ((intptr_t) (void *) value < (intptr_t) (void *) other)
+            ? SYM(less)
+            : SYM(more);
     } else if (haveSameClass(value, other)) {
         return METH_CALL(value, crossOrder, other);
     } else {
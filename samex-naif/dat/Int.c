@@ -17,15 +17,15 @@
 //
 
 enum {
-    /** Count of cached small int value. */
-    DAT_SMALL_INT_COUNT = DAT_SMALL_INT_MAX - DAT_SMALL_INT_MIN + 1
-};
+    /** Maximum (highest) value that can be an immediate int. */
+    DAT_IMMEDIATE_INT_MAX = ZINT_MAX / 2,
 
-/** Array of small integer values. */
-static zvalue SMALL_INTS[DAT_SMALL_INT_COUNT];
+    /** Minimum (lowest) value that can be an immediate int. */
+    DAT_IMMEDIATE_INT_MIN = -DAT_IMMEDIATE_INT_MAX - 1
+};
 
 /**
- * Int structure.
+ * Int structure, for ints which are out of the range of immediate ints.
  */
 typedef struct {
     /** Int value. */
@@ -37,11 +37,15 @@ typedef struct {
  * type checking.
  */
 static zint zintValue(zvalue intval) {
+    if (datIsImmediateInt(intval)) {
+        return ((intptr_t) (void *) intval - DAT_IMMEDIATE_INT_TAG) / 2;
+    }
+
     return ((IntInfo *) datPayload(intval))->value;
 }
 
 /**
- * Constructs and returns an int.
+ * Constructs and returns a heap-allocated int.
  */
 static zvalue intFrom(zint value) {
     zvalue result = datAllocValue(CLS_Int, sizeof(IntInfo));
@@ -57,8 +61,9 @@ static zvalue intFrom(zint value) {
 
 // Documented in header.
 zvalue intFromZint(zint value) {
-    if ((value >= DAT_SMALL_INT_MIN) && (value < DAT_SMALL_INT_MAX)) {
-        return SMALL_INTS[value - DAT_SMALL_INT_MIN];
+    if ((value >= DAT_IMMEDIATE_INT_MIN) && (value <= DAT_IMMEDIATE_INT_MAX)) {
+        // Doubling leaves the low bit clear, for the tag.
+        return (zvalue) (intptr_t) ((value * 2) | DAT_IMMEDIATE_INT_TAG);
     } else {
         return intFrom(value);
     }
@@ -187,10 +192,6 @@ MOD_INIT(Int) {
             METH_BIND(Int, sub),
             METH_BIND(Int, xor)));
 
-    for (zint i = 0; i < DAT_SMALL_INT_COUNT; i++) {
-        SMALL_INTS[i] = datImmortalize(intFrom(i + DAT_SMALL_INT_MIN));
-    }
-
     INT_0    = intFromZint(0);
     INT_1    = intFromZint(1);
     INT_NEG1 = intFromZint(-1);
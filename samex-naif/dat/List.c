@@ -17,23 +17,87 @@
 //
 
 /**
- * List structure.
+ * List structure. Small lists are "flat," that is, they hold their
+ * elements in a single array, either directly or by referring to the
+ * content of another list. Larger lists built up by concatenation or
+ * slicing are held as relaxed radix-balanced trees, whose interior nodes
+ * are instances of the private class `ListNode` and whose leaves are flat
+ * lists. Operations on tree lists copy just the paths from the root to the
+ * affected leaves, sharing all the rest.
  */
 typedef struct {
-    /** Size and pointer to elements. */
+    /** Size and pointer to elements. For a tree list, `elems` is `NULL`. */
     zarray a;
 
     /**
      * Another list which contains the actual content, or `NULL` if the
-     * content is in `content` (below). This is just used to keep the
-     * elements from getting gc'ed out from under this instance.
+     * content is in `content` (below) or this is a tree list. This is just
+     * used to keep the elements from getting gc'ed out from under this
+     * instance.
      */
     zvalue contentList;
 
+    /** Root node of the tree, for a tree list. `NULL` for a flat list. */
+    zvalue root;
+
     /** List elements, if `contentList` is `NULL`. */
     zvalue content[/*a.size*/];
 } ListInfo;
 
+/**
+ * Entry in a `ListNode`.
+ */
+typedef struct {
+    /**
+     * Index just past the last element of `child`, relative to the start
+     * of the node. That is, the sum of the sizes of this entry's `child`
+     * and all the ones before it.
+     */
+    zint end;
+
+    /** Child node. Either a non-empty flat list or a `ListNode`. */
+    zvalue child;
+} ListNodeEntry;
+
+/**
+ * `ListNode` structure.
+ */
+typedef struct {
+    /** Height of the node. `1` indicates that the children are flat lists. */
+    zint height;
+
+    /** Number of children. Always at least `2`. */
+    zint count;
+
+    /** Children, in order. */
+    ListNodeEntry entries[/*count*/];
+} ListNodeInfo;
+
+/**
+ * Cursor for walking the elements of a list in order, without making a
+ * flat copy of a tree list. The list must remain referenced for as long as
+ * the cursor is in use.
+ */
+typedef struct {
+    /** Number of nodes in `nodes` (and `indexes`). */
+    zint depth;
+
+    /** Nodes from the root down to the parent of the current leaf. */
+    ListNodeInfo *nodes[DAT_MAX_LIST_TREE_HEIGHT];
+
+    /** Index of the child taken at each of `nodes`. */
+    zint indexes[DAT_MAX_LIST_TREE_HEIGHT];
+
+    /** Elements of the current leaf. */
+    zarray leaf;
+
+    /** Index of the next element of `leaf`. */
+    zint at;
+} ListCursor;
+
+/** Class value for the private class `ListNode`. */
+static zvalue CLS_ListNode = NULL;
+
 /**
  * Gets a pointer to the value's info.
  */
@@ -41,6 +105,13 @@ static ListInfo *getInfo(zvalue list) {
     return datPayload(list);
 }
 
+/**
+ * Gets a pointer to the node's info.
+ */
+static ListNodeInfo *getNodeInfo(zvalue node) {
+    return datPayload(node);
+}
+
 /**
  * Allocates an list of the given size, with built-on elements.
  */
@@ -51,6 +122,7 @@ static zvalue allocList(zint size) {
 
     info->a = (zarray) {size, info->content};
     info->contentList = NULL;
+    info->root = NULL;
 
     return result;
 }
@@ -58,7 +130,7 @@ static zvalue allocList(zint size) {
 /**
  * Makes a list that refers to a content list. Does not do any type or
  * bounds checking. It *does* shunt from an already-indirect list to the
- * ultimate bearer of content.
+ * ultimate bearer of content. The given `list` must be flat.
  */
 static zvalue makeIndirectList(zvalue list, zint offset, zint size) {
     if (size == 0) {
@@ -96,29 +168,432 @@ static zvalue listFromUnchecked(zarray arr) {
     return result;
 }
 
+/**
+ * Gets the height of the given subtree (a flat list or a `ListNode`).
+ * Flat lists have height `0`.
+ */
+static zint subtreeHeight(zvalue subtree) {
+    return (classOf(subtree) == CLS_List)
+        ? 0
+        : getNodeInfo(subtree)->height;
+}
+
+/**
+ * Gets the number of elements in the given subtree (a flat list or a
+ * `ListNode`).
+ */
+static zint subtreeSize(zvalue subtree) {
+    if (classOf(subtree) == CLS_List) {
+        return getInfo(subtree)->a.size;
+    }
+
+    ListNodeInfo *info = getNodeInfo(subtree);
+    return info->entries[info->count - 1].end;
+}
+
+/**
+ * Gets the root of the tree of the given list. For a flat list, this is
+ * the list itself.
+ */
+static zvalue getRoot(zvalue list) {
+    zvalue root = getInfo(list)->root;
+    return (root == NULL) ? list : root;
+}
+
+/**
+ * Allocates a `ListNode` with the given children, which must all be of the
+ * same height.
+ */
+static zvalue makeNode(zint count, zvalue *children) {
+    zvalue result = datAllocValue(CLS_ListNode,
+        sizeof(ListNodeInfo) + count * sizeof(ListNodeEntry));
+    ListNodeInfo *info = getNodeInfo(result);
+    zint end = 0;
+
+    for (zint i = 0; i < count; i++) {
+        end += subtreeSize(children[i]);
+        info->entries[i] = (ListNodeEntry) {end, children[i]};
+    }
+
+    info->height = subtreeHeight(children[0]) + 1;
+    info->count = count;
+    return result;
+}
+
+/**
+ * Makes a subtree with the given children, which must all be of the same
+ * height. If there are too many children for one node, this splits them
+ * evenly between two nodes, and returns a new parent of those two.
+ */
+static zvalue nodeFromChildren(zint count, zvalue *children) {
+    if (count <= DAT_MAX_LIST_NODE_CHILDREN) {
+        return makeNode(count, children);
+    }
+
+    zint half = count / 2;
+    zvalue left = makeNode(half, children);
+    zvalue right = makeNode(count - half, &children[half]);
+
+    return makeNode(2, (zvalue[]) {left, right});
+}
+
+/**
+ * Copies the children of the given node into `result`, returning the
+ * number of children copied.
+ */
+static zint copyChildren(zvalue *result, zvalue node) {
+    ListNodeInfo *info = getNodeInfo(node);
+
+    for (zint i = 0; i < info->count; i++) {
+        result[i] = info->entries[i].child;
+    }
+
+    return info->count;
+}
+
+/**
+ * Copies all the elements under the given subtree (a flat list or a
+ * `ListNode`) into `result`, in order. Returns the number of elements
+ * copied.
+ */
+static zint copyElems(zvalue *result, zvalue subtree) {
+    if (classOf(subtree) == CLS_List) {
+        zarray arr = getInfo(subtree)->a;
+        utilCpy(zvalue, result, arr.elems, arr.size);
+        return arr.size;
+    }
+
+    ListNodeInfo *info = getNodeInfo(subtree);
+    zint at = 0;
+
+    for (zint i = 0; i < info->count; i++) {
+        at += copyElems(&result[at], info->entries[i].child);
+    }
+
+    return at;
+}
+
+/**
+ * Gets the elements of the given list. For a flat list, this is its own
+ * storage. For a tree list, this makes a flat copy, which remains valid for
+ * as long as the current frame.
+ */
+static zarray getArr(zvalue list) {
+    ListInfo *info = getInfo(list);
+
+    if (info->root == NULL) {
+        return info->a;
+    }
+
+    zvalue flat = allocList(info->a.size);
+
+    copyElems(getInfo(flat)->content, info->root);
+    return getInfo(flat)->a;
+}
+
+/**
+ * Sets up the given cursor to start at the first element of the given
+ * subtree (a flat list or a `ListNode`), taking the leftmost path down from
+ * it.
+ */
+static void cursorDescend(ListCursor *cursor, zvalue subtree) {
+    while (classOf(subtree) != CLS_List) {
+        ListNodeInfo *info = getNodeInfo(subtree);
+
+        cursor->nodes[cursor->depth] = info;
+        cursor->indexes[cursor->depth] = 0;
+        cursor->depth++;
+        subtree = info->entries[0].child;
+    }
+
+    cursor->leaf = getInfo(subtree)->a;
+    cursor->at = 0;
+}
+
+/**
+ * Sets up the given cursor to walk the given list from the start.
+ */
+static void cursorInit(ListCursor *cursor, zvalue list) {
+    cursor->depth = 0;
+    cursorDescend(cursor, getRoot(list));
+}
+
+/**
+ * Gets the next element from the given cursor, or `NULL` if there are no
+ * more elements.
+ */
+static zvalue cursorNext(ListCursor *cursor) {
+    while (cursor->at == cursor->leaf.size) {
+        // The current leaf is used up. Go up to the nearest node with
+        // another child, and then down to that child's first leaf.
+        for (;;) {
+            if (cursor->depth == 0) {
+                return NULL;
+            }
+
+            zint d = cursor->depth - 1;
+            ListNodeInfo *info = cursor->nodes[d];
+            zint next = cursor->indexes[d] + 1;
+
+            if (next < info->count) {
+                cursor->indexes[d] = next;
+                cursorDescend(cursor, info->entries[next].child);
+                break;
+            }
+
+            cursor->depth--;
+        }
+    }
+
+    zvalue result = cursor->leaf.elems[cursor->at];
+    cursor->at++;
+    return result;
+}
+
+/**
+ * Copies all the elements of the given list into `result`, in order.
+ */
+static void copyList(zvalue *result, zvalue list) {
+    ListInfo *info = getInfo(list);
+
+    if (info->root == NULL) {
+        utilCpy(zvalue, result, info->a.elems, info->a.size);
+    } else {
+        copyElems(result, info->root);
+    }
+}
+
+/**
+ * Given a node's info, finds the index of the child which holds the
+ * element at the given index.
+ */
+static zint nodeFind(ListNodeInfo *info, zint index) {
+    zint min = 0;
+    zint max = info->count - 1;
+
+    // Find the first entry whose `end` is past `index`. The sizes of
+    // children vary, so this is a search of the size table and not just
+    // a radix calculation.
+    while (min < max) {
+        zint guess = (min + max) / 2;
+
+        if (info->entries[guess].end > index) {
+            max = guess;
+        } else {
+            min = guess + 1;
+        }
+    }
+
+    return min;
+}
+
+/**
+ * Gets the index of the first element of the child at the given index of
+ * the given node, relative to the start of the node.
+ */
+static zint childStart(ListNodeInfo *info, zint childIndex) {
+    return (childIndex == 0) ? 0 : info->entries[childIndex - 1].end;
+}
+
+/**
+ * Gets the element at the given index of the given list. Does not do any
+ * bounds checking.
+ */
+static zvalue nthUnchecked(zvalue list, zint index) {
+    ListInfo *info = getInfo(list);
+
+    if (info->a.elems != NULL) {
+        return info->a.elems[index];
+    }
+
+    zvalue subtree = info->root;
+
+    while (classOf(subtree) != CLS_List) {
+        ListNodeInfo *nodeInfo = getNodeInfo(subtree);
+        zint i = nodeFind(nodeInfo, index);
+
+        index -= childStart(nodeInfo, i);
+        subtree = nodeInfo->entries[i].child;
+    }
+
+    return getInfo(subtree)->a.elems[index];
+}
+
+/**
+ * Concatenates two non-empty subtrees (each a flat list or a `ListNode`),
+ * which may be of different heights. The result is at most one level
+ * taller than the taller of the two. Only the nodes along the right edge
+ * of `left` and the left edge of `right` get copied. Adjacent flat lists
+ * get merged when they are small enough, so that building up a list an
+ * element at a time results in full leaves.
+ */
+static zvalue join(zvalue left, zvalue right) {
+    zint leftHeight = subtreeHeight(left);
+    zint rightHeight = subtreeHeight(right);
+    zvalue children[DAT_MAX_LIST_NODE_CHILDREN * 2];
+    zint count;
+
+    if (leftHeight > rightHeight) {
+        // Join `right` onto the last child of `left`.
+        count = copyChildren(children, left);
+        zvalue last = join(children[count - 1], right);
+
+        if (subtreeHeight(last) == leftHeight) {
+            // The last child had to be split.
+            count += copyChildren(&children[count - 1], last) - 1;
+        } else {
+            children[count - 1] = last;
+        }
+    } else if (leftHeight < rightHeight) {
+        // Join `left` onto the first child of `right`.
+        zvalue rightChildren[DAT_MAX_LIST_NODE_CHILDREN];
+        zint rightCount = copyChildren(rightChildren, right);
+        zvalue first = join(left, rightChildren[0]);
+
+        if (subtreeHeight(first) == rightHeight) {
+            // The first child had to be split.
+            count = copyChildren(children, first);
+        } else {
+            children[0] = first;
+            count = 1;
+        }
+
+        utilCpy(zvalue, &children[count], &rightChildren[1], rightCount - 1);
+        count += rightCount - 1;
+    } else if (leftHeight != 0) {
+        // Two nodes of the same height. Combine their children.
+        count = copyChildren(children, left);
+        count += copyChildren(&children[count], right);
+    } else {
+        // Two flat lists.
+        zarray leftArr = getInfo(left)->a;
+        zarray rightArr = getInfo(right)->a;
+        zint size = leftArr.size + rightArr.size;
+
+        if (size > DAT_MAX_FLAT_LIST_SIZE) {
+            return makeNode(2, (zvalue[]) {left, right});
+        }
+
+        zvalue elems[size];
+        utilCpy(zvalue, elems, leftArr.elems, leftArr.size);
+        utilCpy(zvalue, &elems[leftArr.size], rightArr.elems, rightArr.size);
+        return listFromUnchecked((zarray) {size, elems});
+    }
+
+    return nodeFromChildren(count, children);
+}
+
+/**
+ * Slices a flat list. `start` and `end` must be valid, with `start < end`.
+ */
+static zvalue flatSlice(zvalue list, zint start, zint end) {
+    zarray arr = getInfo(list)->a;
+    zint size = end - start;
+
+    if (size == arr.size) {
+        return list;
+    } else if (size > 16) {
+        // Share storage for large results.
+        return makeIndirectList(list, start, size);
+    } else {
+        return listFromUnchecked((zarray) {size, &arr.elems[start]});
+    }
+}
+
+/**
+ * Slices a subtree (a flat list or a `ListNode`). `start` and `end` must
+ * be valid, with `start < end`. The result may be shorter than the
+ * original. Children which are entirely within the slice are shared, and
+ * the partial children at either end are sliced recursively and then
+ * joined back on.
+ */
+static zvalue subtreeSlice(zvalue subtree, zint start, zint end) {
+    if (classOf(subtree) == CLS_List) {
+        return flatSlice(subtree, start, end);
+    }
+
+    ListNodeInfo *info = getNodeInfo(subtree);
+
+    if ((start == 0) && (end == info->entries[info->count - 1].end)) {
+        return subtree;
+    }
+
+    zint first = nodeFind(info, start);
+    zint last = nodeFind(info, end - 1);
+    zint firstStart = childStart(info, first);
+    zint lastStart = childStart(info, last);
+
+    if (first == last) {
+        return subtreeSlice(info->entries[first].child,
+            start - firstStart, end - firstStart);
+    }
+
+    zvalue result = subtreeSlice(info->entries[first].child,
+        start - firstStart, info->entries[first].end - firstStart);
+    zint middleCount = last - first - 1;
+
+    if (middleCount == 1) {
+        result = join(result, info->entries[first + 1].child);
+    } else if (middleCount > 1) {
+        zvalue children[middleCount];
+
+        for (zint i = 0; i < middleCount; i++) {
+            children[i] = info->entries[first + 1 + i].child;
+        }
+
+        result = join(result, makeNode(middleCount, children));
+    }
+
+    return join(result,
+        subtreeSlice(info->entries[last].child, 0, end - lastStart));
+}
+
+/**
+ * Returns the list whose tree has the given root. If the root is a flat
+ * list then it is itself the result. If the tree is small enough, then the
+ * result is a flat list.
+ */
+static zvalue listFromRoot(zvalue root) {
+    if (classOf(root) == CLS_List) {
+        return root;
+    }
+
+    zint size = subtreeSize(root);
+
+    if (size <= DAT_MAX_FLAT_LIST_SIZE) {
+        zvalue result = allocList(size);
+        copyElems(getInfo(result)->content, root);
+        return result;
+    }
+
+    zvalue result = datAllocValue(CLS_List, sizeof(ListInfo));
+    ListInfo *info = getInfo(result);
+
+    info->a = (zarray) {size, NULL};
+    info->root = root;
+    return result;
+}
+
 /**
  * Helper that does most of the work of the `slice*` methods.
  */
 static zvalue doSlice(zvalue ths, bool inclusive,
         zvalue startArg, zvalue endArg) {
     ListInfo *info = getInfo(ths);
-    zarray arr = info->a;
     zint start;
     zint end;
 
-    seqConvertSliceArgs(&start, &end, inclusive, arr.size, startArg, endArg);
+    seqConvertSliceArgs(&start, &end, inclusive, info->a.size,
+        startArg, endArg);
 
     if (start == -1) {
         return NULL;
-    }
-
-    zint size = end - start;
-
-    if (size > 16) {
-        // Share storage for large results.
-        return makeIndirectList(ths, start, size);
+    } else if (start == end) {
+        return EMPTY_LIST;
+    } else if (info->root == NULL) {
+        return flatSlice(ths, start, end);
     } else {
-        return listFromUnchecked((zarray) {end - start, &arr.elems[start]});
+        return listFromRoot(subtreeSlice(info->root, start, end));
     }
 }
 
@@ -139,6 +614,21 @@ zvalue listPrepend(zvalue elem, zvalue list) {
     return cm_cat(listFromValue(elem), list);
 }
 
+// Documented in header.
+zvalue listFlatten(zvalue list) {
+    assertHasClass(list, CLS_List);
+
+    ListInfo *info = getInfo(list);
+
+    if (info->root == NULL) {
+        return list;
+    }
+
+    zvalue result = allocList(info->a.size);
+    copyElems(getInfo(result)->content, info->root);
+    return result;
+}
+
 // Documented in header.
 zvalue listFromValue(zvalue value) {
     return listFromZarray((zarray) {1, &value});
@@ -158,7 +648,7 @@ zvalue listFromZarray(zarray arr) {
 // Documented in header.
 zarray zarrayFromList(zvalue list) {
     assertHasClass(list, CLS_List);
-    return getInfo(list)->a;
+    return getArr(list);
 }
 
 
@@ -178,15 +668,34 @@ METH_IMPL_rest(List, cat, args) {
     }
 
     ListInfo *thsInfo = getInfo(ths);
-    zarray thsArr = thsInfo->a;
+    zint size = thsInfo->a.size;
 
-    zint size = thsArr.size;
     for (zint i = 0; i < args.size; i++) {
         zvalue one = args.elems[i];
         assertHasClass(one, CLS_List);
         size += getInfo(one)->a.size;
     }
 
+    if (size > DAT_MAX_FLAT_LIST_SIZE) {
+        // The result is a tree. Join together all the non-empty arguments.
+        zvalue root = (thsInfo->a.size == 0) ? NULL : getRoot(ths);
+
+        for (zint i = 0; i < args.size; i++) {
+            zvalue one = args.elems[i];
+
+            if (getInfo(one)->a.size == 0) {
+                continue;
+            }
+
+            root = (root == NULL) ? getRoot(one) : join(root, getRoot(one));
+        }
+
+        return listFromRoot(root);
+    }
+
+    // The result is flat, which means that all the arguments are too.
+
+    zarray thsArr = thsInfo->a;
     zvalue elems[size];
     zint at = thsArr.size;
     utilCpy(zvalue, elems, thsArr.elems, thsArr.size);
@@ -207,13 +716,20 @@ METH_IMPL_0_opt(List, collect, function) {
         return ths;
     }
 
-    ListInfo *info = getInfo(ths);
-    zarray arr = info->a;
-    zvalue result[arr.size];
+    zvalue *result = utilAlloc(getInfo(ths)->a.size * sizeof(zvalue));
     zint at = 0;
+    ListCursor cursor;
 
-    for (zint i = 0; i < arr.size; i++) {
-        zvalue one = FUN_CALL(function, arr.elems[i]);
+    cursorInit(&cursor, ths);
+
+    for (;;) {
+        zvalue elem = cursorNext(&cursor);
+
+        if (elem == NULL) {
+            break;
+        }
+
+        zvalue one = FUN_CALL(function, elem);
 
         if (one != NULL) {
             result[at] = one;
@@ -221,75 +737,78 @@ METH_IMPL_0_opt(List, collect, function) {
         }
     }
 
-    return listFromUnchecked((zarray) {at, result});
+    zvalue resultList = listFromUnchecked((zarray) {at, result});
+    utilFree(result);
+    return resultList;
 }
 
 // Documented in spec.
 METH_IMPL_1(List, crossEq, other) {
     assertHasClass(other, CLS_List);  // Note: Not guaranteed to be a `List`.
-    ListInfo *info1 = getInfo(ths);
-    ListInfo *info2 = getInfo(other);
-    zarray arr1 = info1->a;
-    zarray arr2 = info2->a;
 
-    if (arr1.size != arr2.size) {
+    if (getInfo(ths)->a.size != getInfo(other)->a.size) {
         return NULL;
     }
 
-    for (zint i = 0; i < arr1.size; i++) {
-        if (!cmpEq(arr1.elems[i], arr2.elems[i])) {
+    ListCursor cursor1;
+    ListCursor cursor2;
+
+    cursorInit(&cursor1, ths);
+    cursorInit(&cursor2, other);
+
+    for (;;) {
+        zvalue one = cursorNext(&cursor1);
+
+        if (one == NULL) {
+            return ths;
+        } else if (!cmpEq(one, cursorNext(&cursor2))) {
             return NULL;
         }
     }
-
-    return ths;
 }
 
 // Documented in spec.
 METH_IMPL_1(List, crossOrder, other) {
     assertHasClass(other, CLS_List);  // Note: Not guaranteed to be a `List`.
-    ListInfo *info1 = getInfo(ths);
-    ListInfo *info2 = getInfo(other);
-    zarray arr1 = info1->a;
-    zarray arr2 = info2->a;
-    zint size = (arr1.size < arr2.size) ? arr1.size : arr2.size;
+    zint size1 = getInfo(ths)->a.size;
+    zint size2 = getInfo(other)->a.size;
+    zint size = (size1 < size2) ? size1 : size2;
+    ListCursor cursor1;
+    ListCursor cursor2;
+
+    cursorInit(&cursor1, ths);
+    cursorInit(&cursor2, other);
 
     for (zint i = 0; i < size; i++) {
-        zorder result = cm_order(arr1.elems[i], arr2.elems[i]);
+        zorder result = cm_order(cursorNext(&cursor1), cursorNext(&cursor2));
         if (result != ZSAME) {
             return symbolFromZorder(result);
         }
     }
 
-    if (arr1.size == arr2.size) {
+    if (size1 == size2) {
         return SYM(same);
     }
 
-    return (arr1.size < arr2.size) ? SYM(less): SYM(more);
+    return (size1 < size2) ? SYM(less): SYM(more);
 }
 
 // Documented in spec.
 METH_IMPL_rest(List, del, ns) {
-    ListInfo *info = getInfo(ths);
-    zarray arr = info->a;
-    zvalue elems[arr.size];
-    bool any = false;
-
-    if ((ns.size == 0) || (arr.size == 0)) {
+    if ((ns.size == 0) || (getInfo(ths)->a.size == 0)) {
         // Easy outs: Not actually deleting anything, and/or starting out
         // with the empty list.
         return ths;
     }
 
-    // Make a local copy of the original elements.
-    utilCpy(zvalue, elems, info->a.elems, arr.size);
+    zint size = getInfo(ths)->a.size;
+    bool any = false;
 
-    // Null out the values at any valid `n` (leniently).
     for (zint i = 0; i < ns.size; i++) {
         zint index = seqNthIndexLenient(ns.elems[i]);
-        if ((index >= 0) && (index < arr.size)) {
+        if ((index >= 0) && (index < size)) {
             any = true;
-            elems[index] = NULL;
+            break;
         }
     }
 
@@ -298,9 +817,21 @@ METH_IMPL_rest(List, del, ns) {
         return ths;
     }
 
+    // Make a local copy of the original elements.
+    zvalue *elems = utilAlloc(size * sizeof(zvalue));
+    copyList(elems, ths);
+
+    // Null out the values at any valid `n` (leniently).
+    for (zint i = 0; i < ns.size; i++) {
+        zint index = seqNthIndexLenient(ns.elems[i]);
+        if ((index >= 0) && (index < size)) {
+            elems[index] = NULL;
+        }
+    }
+
     // Compact away the holes.
     zint at = 0;
-    for (zint i = 0; i < arr.size; i++) {
+    for (zint i = 0; i < size; i++) {
         if (elems[i] != NULL) {
             if (i != at) {
                 elems[at] = elems[i];
@@ -311,7 +842,9 @@ METH_IMPL_rest(List, del, ns) {
 
     // Construct a new instance with the remaining elements. This call
     // handles returning `EMPTY_LIST` when appropriate.
-    return listFromUnchecked((zarray) {at, elems});
+    zvalue result = listFromUnchecked((zarray) {at, elems});
+    utilFree(elems);
+    return result;
 }
 
 // Documented in spec.
@@ -334,17 +867,26 @@ METH_IMPL_0(List, fetch) {
 
 // Documented in spec.
 METH_IMPL_0_opt(List, forEach, function) {
-    ListInfo *info = getInfo(ths);
-    zarray arr = info->a;
-    zvalue result = NULL;
+    zint size = getInfo(ths)->a.size;
 
     if (function == NULL) {
         // Without a function, this method just returns the last element.
-        return (arr.size == 0) ? NULL : arr.elems[arr.size - 1];
+        return (size == 0) ? NULL : nthUnchecked(ths, size - 1);
     }
 
-    for (zint i = 0; i < arr.size; i++) {
-        zvalue v = FUN_CALL(function, arr.elems[i]);
+    zvalue result = NULL;
+    ListCursor cursor;
+
+    cursorInit(&cursor, ths);
+
+    for (;;) {
+        zvalue elem = cursorNext(&cursor);
+
+        if (elem == NULL) {
+            break;
+        }
+
+        zvalue v = FUN_CALL(function, elem);
         if (v != NULL) {
             result = v;
         }
@@ -360,6 +902,12 @@ METH_IMPL_0(List, gcMark) {
 
     datMark(info->contentList);
 
+    if (info->root != NULL) {
+        // The elements are all marked via the tree.
+        datMark(info->root);
+        return NULL;
+    }
+
     for (zint i = 0; i < arr.size; i++) {
         datMark(arr.elems[i]);
     }
@@ -374,35 +922,36 @@ METH_IMPL_0(List, get_size) {
 
 // Documented in spec.
 METH_IMPL_1(List, nextValue, box) {
-    ListInfo *info = getInfo(ths);
-    zarray arr = info->a;
+    zint size = getInfo(ths)->a.size;
 
-    if (arr.size == 0) {
+    if (size == 0) {
         // `list` is empty.
         return NULL;
     }
 
     // Yield the first element via the box, and return a list of the
-    // remainder. `makeIndirectList` handles returning `EMPTY_LIST` when
-    // appropriate.
+    // remainder. For a tree list, the remainder is a slice of the tree,
+    // which shares all but the left edge of it. For a flat list,
+    // `makeIndirectList` handles returning `EMPTY_LIST` when appropriate.
+
+    cm_store(box, nthUnchecked(ths, 0));
 
-    cm_store(box, arr.elems[0]);
-    return makeIndirectList(ths, 1, arr.size - 1);
+    zvalue root = getInfo(ths)->root;
+    return (root == NULL)
+        ? makeIndirectList(ths, 1, size - 1)
+        : listFromRoot(subtreeSlice(root, 1, size));
 }
 
 // Documented in spec.
 METH_IMPL_1(List, nth, n) {
-    ListInfo *info = getInfo(ths);
-    zarray arr = info->a;
-    zint index = seqNthIndexStrict(arr.size, n);
+    zint index = seqNthIndexStrict(getInfo(ths)->a.size, n);
 
-    return (index < 0) ? NULL : arr.elems[index];
+    return (index < 0) ? NULL : nthUnchecked(ths, index);
 }
 
 // Documented in spec.
 METH_IMPL_1(List, repeat, count) {
-    ListInfo *thsInfo = getInfo(ths);
-    zarray arr = thsInfo->a;
+    zint thsSize = getInfo(ths)->a.size;
     zint n = zintFromInt(count);
 
     if (n < 0) {
@@ -411,12 +960,14 @@ METH_IMPL_1(List, repeat, count) {
         return EMPTY_LIST;
     }
 
-    zint size = n * arr.size;
+    zint size = n * thsSize;
     zvalue result = allocList(size);
     zvalue *content = getInfo(result)->content;
 
-    for (zint i = 0; i < n; i++) {
-        utilCpy(zvalue, &content[i * arr.size], arr.elems, arr.size);
+    copyList(content, ths);
+
+    for (zint i = 1; i < n; i++) {
+        utilCpy(zvalue, &content[i * thsSize], content, thsSize);
     }
 
     return result;
@@ -424,22 +975,24 @@ METH_IMPL_1(List, repeat, count) {
 
 // Documented in spec.
 METH_IMPL_0(List, reverse) {
-    ListInfo *info = getInfo(ths);
-    zarray thsArr = info->a;
-    zint size = thsArr.size;
+    zint size = getInfo(ths)->a.size;
 
     if (size < 2) {
         // Easy cases.
         return ths;
     }
 
-    zvalue arr[size];
+    zvalue result = allocList(size);
+    zvalue *content = getInfo(result)->content;
+    ListCursor cursor;
 
-    for (zint i = 0, j = size - 1; i < size; i++, j--) {
-        arr[i] = thsArr.elems[j];
+    cursorInit(&cursor, ths);
+
+    for (zint i = size - 1; i >= 0; i--) {
+        content[i] = cursorNext(&cursor);
     }
 
-    return listFromUnchecked((zarray) {size, arr});
+    return result;
 }
 
 
@@ -458,6 +1011,17 @@ METH_IMPL_0(List, valueList) {
     return ths;
 }
 
+// Documented in header.
+METH_IMPL_0(ListNode, gcMark) {
+    ListNodeInfo *info = getNodeInfo(ths);
+
+    for (zint i = 0; i < info->count; i++) {
+        datMark(info->entries[i].child);
+    }
+
+    return NULL;
+}
+
 /** Initializes the module. */
 MOD_INIT(List) {
     MOD_USE(Sequence);
@@ -487,6 +1051,15 @@ MOD_INIT(List) {
             SYM(reverseNth),   FUN_Sequence_reverseNth,
             SYM(sliceGeneral), FUN_Sequence_sliceGeneral));
 
+    classSetThreadSafeGcMark(CLS_List);
+
+    CLS_ListNode = makeCoreClass(SYM(ListNode), CLS_Core,
+        NULL,
+        METH_TABLE(
+            METH_BIND(ListNode, gcMark)));
+
+    classSetThreadSafeGcMark(CLS_ListNode);
+
     EMPTY_LIST = datImmortalize(allocList(0));
 }
 
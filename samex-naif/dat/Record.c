@@ -273,6 +273,8 @@ MOD_INIT(Record) {
             METH_BIND(Record, get_data),
             METH_BIND(Record, get_name),
             METH_BIND(Record, hasName)));
+
+    classSetThreadSafeGcMark(CLS_Record);
 }
 
 // Documented in header.
@@ -3,6 +3,7 @@
 // Version 2.0. Details: <http://www.apache.org/licenses/LICENSE-2.0>
 
 #include <stdlib.h>
+#include <string.h>
 
 #include "type/Box.h"
 #include "type/Cmp.h"
@@ -28,10 +29,21 @@ static zvalue CACHED_CHARS[DAT_MAX_CACHED_CHAR + 1];
 static zchar SHARED_ARRAY[DAT_MAX_STRING_SOFT];
 
 /**
- * String structure.
+ * String structure. Characters are stored in the narrowest width (see
+ * `zstring`) which can hold all of them, with the exception that an
+ * indirect string (see `makeIndirectString()`) has the same width as the
+ * string it refers to.
+ *
+ * Large strings built by `cat` are instead "ropes," that is, binary trees
+ * of the strings which were concatenated, kept balanced as AVL trees. A
+ * rope is flattened (see `getString()`) the first time its characters are
+ * needed, at which point it becomes an indirect string.
  */
 typedef struct {
-    /** Size and pointer to characters. */
+    /**
+     * Size, width, and pointer to characters. For a rope which hasn't
+     * been flattened, `chars` is `NULL`.
+     */
     zstring s;
 
     /**
@@ -41,8 +53,20 @@ typedef struct {
      */
     zvalue contentString;
 
-    /** Characters of the string, if `contentString` is `NULL`. */
-    zchar content[/*s.size*/];
+    /** Left (first) half of a rope. `NULL` if not a rope. */
+    zvalue left;
+
+    /** Right (second) half of a rope. `NULL` if not a rope. */
+    zvalue right;
+
+    /** Height of a rope. `0` if not a rope. */
+    zint height;
+
+    /**
+     * Characters of the string, if `contentString` is `NULL`. Each
+     * character takes `s.width` bytes.
+     */
+    uint8_t content[/*s.size * s.width*/];
 } StringInfo;
 
 /**
@@ -53,23 +77,229 @@ static StringInfo *getInfo(zvalue string) {
 }
 
 /**
- * Allocates a string with the given size allocated with the value.
+ * Allocates a string with the given size and character width, with the
+ * characters allocated with the value.
  */
-static zvalue allocString(zint size) {
+static zvalue allocString(zint size, zint width) {
     zvalue result =
-        datAllocValue(CLS_String, sizeof(StringInfo) + size * sizeof(zchar));
+        datAllocValue(CLS_String, sizeof(StringInfo) + size * width);
     StringInfo *info = getInfo(result);
 
-    info->s = (zstring) {size, info->content};
+    info->s = (zstring) {size, width, info->content};
     info->contentString = NULL;
 
     return result;
 }
 
+/**
+ * Allocates a string which is the concatenation of the two given ones,
+ * neither of which may be empty. If the result is small enough and both
+ * arguments are flat, then so is the result. Otherwise, the result is a
+ * rope. This does no balancing (see `join()`).
+ */
+static zvalue makeRope(zvalue left, zvalue right) {
+    StringInfo *leftInfo = getInfo(left);
+    StringInfo *rightInfo = getInfo(right);
+    zint leftSize = leftInfo->s.size;
+    zint size = leftSize + rightInfo->s.size;
+    zint width = (leftInfo->s.width > rightInfo->s.width)
+        ? leftInfo->s.width
+        : rightInfo->s.width;
+
+    if ((size <= DAT_MAX_ROPE_LEAF_SIZE)
+        && (leftInfo->height == 0) && (rightInfo->height == 0)) {
+        zvalue result = allocString(size, width);
+        uint8_t *content = getInfo(result)->content;
+
+        arrayFromZstringWidth(content, width, leftInfo->s);
+        arrayFromZstringWidth(&content[leftSize * width], width,
+            rightInfo->s);
+        return result;
+    }
+
+    zint height = (leftInfo->height > rightInfo->height)
+        ? leftInfo->height
+        : rightInfo->height;
+    zvalue result = datAllocValue(CLS_String, sizeof(StringInfo));
+    StringInfo *info = getInfo(result);
+
+    info->s = (zstring) {size, width, NULL};
+    info->left = left;
+    info->right = right;
+    info->height = height + 1;
+    return result;
+}
+
+/**
+ * Makes a rope from the two given strings, whose heights differ by no more
+ * than two, performing an AVL rotation if needed to keep the result
+ * balanced.
+ */
+static zvalue balance(zvalue left, zvalue right) {
+    StringInfo *leftInfo = getInfo(left);
+    StringInfo *rightInfo = getInfo(right);
+
+    if (rightInfo->height > (leftInfo->height + 1)) {
+        zvalue rl = rightInfo->left;
+        zvalue rr = rightInfo->right;
+        StringInfo *rlInfo = getInfo(rl);
+
+        if (getInfo(rr)->height >= rlInfo->height) {
+            return makeRope(makeRope(left, rl), rr);
+        } else {
+            return makeRope(makeRope(left, rlInfo->left),
+                makeRope(rlInfo->right, rr));
+        }
+    } else if (leftInfo->height > (rightInfo->height + 1)) {
+        zvalue ll = leftInfo->left;
+        zvalue lr = leftInfo->right;
+        StringInfo *lrInfo = getInfo(lr);
+
+        if (getInfo(ll)->height >= lrInfo->height) {
+            return makeRope(ll, makeRope(lr, right));
+        } else {
+            return makeRope(makeRope(ll, lrInfo->left),
+                makeRope(lrInfo->right, right));
+        }
+    }
+
+    return makeRope(left, right);
+}
+
+/**
+ * Concatenates two non-empty strings, either or both of which may be ropes,
+ * producing a balanced result. This only copies the nodes along the facing
+ * edges of the two, down to the depth at which their heights match. Small
+ * flat strings at the facing edges get merged, so that building up a
+ * string a bit at a time results in reasonably-sized leaves.
+ */
+static zvalue join(zvalue left, zvalue right) {
+    StringInfo *leftInfo = getInfo(left);
+    StringInfo *rightInfo = getInfo(right);
+    zint leftHeight = leftInfo->height;
+    zint rightHeight = rightInfo->height;
+
+    if (leftHeight > (rightHeight + 1)) {
+        return balance(leftInfo->left, join(leftInfo->right, right));
+    } else if (rightHeight > (leftHeight + 1)) {
+        return balance(join(left, rightInfo->left), rightInfo->right);
+    } else if ((rightHeight == 0) && (leftHeight != 0)) {
+        zvalue lr = leftInfo->right;
+        StringInfo *lrInfo = getInfo(lr);
+
+        if ((lrInfo->height == 0)
+            && ((lrInfo->s.size + rightInfo->s.size)
+                <= DAT_MAX_ROPE_LEAF_SIZE)) {
+            return balance(leftInfo->left, makeRope(lr, right));
+        }
+    } else if ((leftHeight == 0) && (rightHeight != 0)) {
+        zvalue rl = rightInfo->left;
+        StringInfo *rlInfo = getInfo(rl);
+
+        if ((rlInfo->height == 0)
+            && ((leftInfo->s.size + rlInfo->s.size)
+                <= DAT_MAX_ROPE_LEAF_SIZE)) {
+            return balance(makeRope(left, rl), rightInfo->right);
+        }
+    }
+
+    return makeRope(left, right);
+}
+
+/**
+ * Copies the characters of the given string (which may be a rope) into
+ * the given result array, whose characters are of the given width.
+ */
+static void copyRope(uint8_t *result, zint width, zvalue string) {
+    StringInfo *info = getInfo(string);
+
+    if (info->height == 0) {
+        arrayFromZstringWidth(result, width, info->s);
+    } else {
+        zvalue left = info->left;
+        copyRope(result, width, left);
+        copyRope(&result[getInfo(left)->s.size * width], width, info->right);
+    }
+}
+
+/**
+ * Makes a flat string which is the concatenation of the given strings
+ * (any of which may be ropes). The widest argument determines the width
+ * of the result.
+ */
+static zvalue flatCat(zint count, const zvalue *strings) {
+    zint size = 0;
+    zint width = 1;
+
+    for (zint i = 0; i < count; i++) {
+        StringInfo *info = getInfo(strings[i]);
+        size += info->s.size;
+        if (info->s.width > width) {
+            width = info->s.width;
+        }
+    }
+
+    zvalue result = allocString(size, width);
+    uint8_t *content = getInfo(result)->content;
+    zint at = 0;
+
+    for (zint i = 0; i < count; i++) {
+        copyRope(&content[at * width], width, strings[i]);
+        at += getInfo(strings[i])->s.size;
+    }
+
+    return result;
+}
+
+/**
+ * Indicates whether the given string is flat and no larger than a rope
+ * leaf.
+ */
+static bool isSmallLeaf(zvalue string) {
+    StringInfo *info = getInfo(string);
+    return (info->height == 0) && (info->s.size <= DAT_MAX_ROPE_LEAF_SIZE);
+}
+
+/**
+ * Gets the `zstring` of the given string. If the string is a rope, this
+ * flattens it first, making it an indirect string.
+ */
+static zstring getString(zvalue string) {
+    StringInfo *info = getInfo(string);
+
+    if (info->height != 0) {
+        zvalue flat = allocString(info->s.size, info->s.width);
+        copyRope(getInfo(flat)->content, info->s.width, string);
+
+        info->s.chars = getInfo(flat)->content;
+        info->contentString = flat;
+        info->left = NULL;
+        info->right = NULL;
+        info->height = 0;
+        datWriteBarrier(string);
+    }
+
+    return info->s;
+}
+
+/**
+ * Gets the narrowest character width which can hold the given character.
+ */
+static zint zcharWidth(zchar ch) {
+    if (ch <= 0xff) {
+        return 1;
+    } else if (ch <= 0xffff) {
+        return 2;
+    } else {
+        return sizeof(zchar);
+    }
+}
+
 /**
  * Makes a string that refers to a content string. Does not do any type or
  * bounds checking. It *does* shunt from an already-indirect string to the
- * ultimate bearer of content.
+ * ultimate bearer of content. The given `string` must not be an
+ * unflattened rope.
  */
 static zvalue makeIndirectString(zvalue string, zint offset, zint size) {
     StringInfo *info = getInfo(string);
@@ -81,7 +311,7 @@ static zvalue makeIndirectString(zvalue string, zint offset, zint size) {
     zvalue result = datAllocValue(CLS_String, sizeof(StringInfo));
     StringInfo *resultInfo = getInfo(result);
 
-    resultInfo->s = (zstring) {size, &info->s.chars[offset]};
+    resultInfo->s = zstringSlice(info->s, offset, size);
     resultInfo->contentString = string;
 
     return result;
@@ -137,9 +367,11 @@ static void freeArray(zchar *array) {
 static bool uncheckedEq(zvalue string1, zvalue string2) {
     if (string1 == string2) {
         return true;
+    } else if (getInfo(string1)->s.size != getInfo(string2)->s.size) {
+        return false;
     }
 
-    return zstringEq(getInfo(string1)->s, getInfo(string2)->s);
+    return zstringEq(getString(string1), getString(string2));
 }
 
 /**
@@ -150,7 +382,7 @@ static zorder uncheckedZorder(zvalue string1, zvalue string2) {
         return ZSAME;
     }
 
-    return zstringOrder(getInfo(string1)->s, getInfo(string2)->s);
+    return zstringOrder(getString(string1), getString(string2));
 }
 
 /**
@@ -170,12 +402,13 @@ static zvalue doSlice(zvalue ths, bool inclusive,
     }
 
     zint size = end - start;
+    zstring s = getString(ths);
 
     if (size > 16) {
         // Share storage for large results.
         return makeIndirectString(ths, start, size);
     } else {
-        return stringFromZstring((zstring) {size, &info->s.chars[start]});
+        return stringFromZstring(zstringSlice(s, start, size));
     }
 }
 
@@ -205,6 +438,10 @@ bool stringEq(zvalue string1, zvalue string2) {
 zvalue stringFromUtf8(zint utfBytes, const char *utf) {
     zint decodedSize = utf8DecodeStringSize(utfBytes, utf);
 
+    if (utfBytes < 0) {
+        utfBytes = strlen(utf);
+    }
+
     switch (decodedSize) {
         case 0: {
             return EMPTY_STRING;
@@ -218,9 +455,19 @@ zvalue stringFromUtf8(zint utfBytes, const char *utf) {
         }
     }
 
-    zvalue result = allocString(decodedSize);
+    if (decodedSize == utfBytes) {
+        // Every character took one byte to encode, which means that they're
+        // all ASCII, and so the encoded form is also the one-byte-wide form.
+        zvalue result = allocString(decodedSize, 1);
+        utilCpy(char, getInfo(result)->content, utf, utfBytes);
+        return result;
+    }
+
+    zchar *chars = allocArray(decodedSize);
+    utf8DecodeCharsFromString(chars, utfBytes, utf);
 
-    utf8DecodeCharsFromString(getInfo(result)->content, utfBytes, utf);
+    zvalue result = stringFromZstring(zstringFromZchars(decodedSize, chars));
+    freeArray(chars);
     return result;
 }
 
@@ -233,8 +480,10 @@ zvalue stringFromZchar(zchar value) {
         }
     }
 
-    zvalue result = allocString(1);
-    getInfo(result)->content[0] = value;
+    zint width = zcharWidth(value);
+    zvalue result = allocString(1, width);
+    arrayFromZstringWidth(getInfo(result)->content, width,
+        zstringFromZchars(1, &value));
 
     if (value <= DAT_MAX_CACHED_CHAR) {
         CACHED_CHARS[value] = result;
@@ -250,12 +499,13 @@ zvalue stringFromZstring(zstring string) {
     // what handles caching of single-character strings.
     switch (string.size) {
         case 0: { return EMPTY_STRING;                     }
-        case 1: { return stringFromZchar(string.chars[0]); }
+        case 1: { return stringFromZchar(zstringNth(string, 0)); }
     }
 
-    zvalue result = allocString(string.size);
+    zint width = zstringMinWidth(string);
+    zvalue result = allocString(string.size, width);
 
-    utilCpy(zchar, getInfo(result)->content, string.chars, string.size);
+    arrayFromZstringWidth(getInfo(result)->content, width, string);
     return result;
 }
 
@@ -269,31 +519,31 @@ zorder stringZorder(zvalue string1, zvalue string2) {
 // Documented in header.
 char *utf8DupFromString(zvalue string) {
     assertString(string);
-    return utf8DupFromZstring(getInfo(string)->s);
+    return utf8DupFromZstring(getString(string));
 }
 
 // Documented in header.
 zint utf8FromString(zint resultSize, char *result, zvalue string) {
     assertString(string);
-    return utf8FromZstring(resultSize, result, getInfo(string)->s);
+    return utf8FromZstring(resultSize, result, getString(string));
 }
 
 // Documented in header.
 zint utf8SizeFromString(zvalue string) {
     assertString(string);
-    return utf8SizeFromZstring(getInfo(string)->s);
+    return utf8SizeFromZstring(getString(string));
 }
 
 // Documented in header.
 zchar zcharFromString(zvalue string) {
     assertStringSize1(string);
-    return getInfo(string)->s.chars[0];
+    return zstringNth(getString(string), 0);
 }
 
 // Documented in header.
 zstring zstringFromString(zvalue string) {
     assertString(string);
-    return getInfo(string)->s;
+    return getString(string);
 }
 
 
@@ -332,7 +582,7 @@ METH_IMPL_1(String, castToward, cls) {
             return intFromZint(zcharFromString(ths));
         }
     } else if (cmpEq(cls, CLS_Symbol)) {
-        return symbolFromZstring(info->s);
+        return symbolFromZstring(getString(ths));
     } else if (typeAccepts(cls, ths)) {
         return ths;
     }
@@ -346,11 +596,12 @@ METH_IMPL_rest(String, cat, args) {
         return ths;
     }
 
-    zint thsSize = getInfo(ths)->s.size;
-    zvalue strings[args.size];
-    StringInfo *infos[args.size];
+    zvalue strings[args.size + 1];
+    zint size = getInfo(ths)->s.size;
+    zvalue only = (size == 0) ? NULL : ths;  // The only non-empty one.
+    bool multiple = false;
 
-    zint size = thsSize;
+    strings[0] = ths;
     for (zint i = 0; i < args.size; i++) {
         zvalue one = args.elems[i];
         if (typeAccepts(CLS_Symbol, one)) {
@@ -358,35 +609,60 @@ METH_IMPL_rest(String, cat, args) {
         } else {
             assertString(one);
         }
-        strings[i] = one;
-        infos[i] = getInfo(one);
-        size += infos[i]->s.size;
+
+        zint oneSize = getInfo(one)->s.size;
+        strings[i + 1] = one;
+
+        if (oneSize != 0) {
+            multiple = multiple || (only != NULL);
+            only = one;
+            size += oneSize;
+        }
     }
 
-    zchar *chars = allocArray(size);
-    zint at = thsSize;
-    arrayFromZstring(chars, getInfo(ths)->s);
-    for (zint i = 0; i < args.size; i++) {
-        zstring one = infos[i]->s;
-        arrayFromZstring(&chars[at], one);
-        at += one.size;
+    if (!multiple) {
+        // At most one argument is non-empty, so it is itself the result.
+        return (only == NULL) ? ths : only;
+    } else if (size <= DAT_MAX_ROPE_LEAF_SIZE) {
+        return flatCat(args.size + 1, strings);
+    }
+
+    // The result is large, so make it a rope. Runs of small flat strings
+    // get combined into single leaves, so that concatenating many small
+    // pieces doesn't produce a deep tree of tiny nodes.
+    zvalue result = NULL;
+    for (zint i = 0; i <= args.size; /*i*/) {
+        zvalue piece = strings[i];
+        zint end = i + 1;
+
+        if (isSmallLeaf(piece)) {
+            while ((end <= args.size) && isSmallLeaf(strings[end])) {
+                end++;
+            }
+
+            if (end != (i + 1)) {
+                piece = flatCat(end - i, &strings[i]);
+            }
+        }
+
+        i = end;
+
+        if (getInfo(piece)->s.size != 0) {
+            result = (result == NULL) ? piece : join(result, piece);
+        }
     }
 
-    zvalue result = stringFromZstring((zstring) {size, chars});
-    freeArray(chars);
     return result;
 }
 
 // Documented in spec.
 METH_IMPL_0_opt(String, collect, function) {
-    StringInfo *info = getInfo(ths);
-    const zchar *chars = info->s.chars;
-    zint size = info->s.size;
-    zvalue *elems = utilAlloc(size * sizeof(zvalue));
+    zstring s = getString(ths);
+    zvalue *elems = utilAlloc(s.size * sizeof(zvalue));
     zint at = 0;
 
-    for (zint i = 0; i < size; i++) {
-        zvalue elem = stringFromZchar(chars[i]);
+    for (zint i = 0; i < s.size; i++) {
+        zvalue elem = stringFromZchar(zstringNth(s, i));
         zvalue one = (function == NULL) ? elem : FUN_CALL(function, elem);
 
         if (one != NULL) {
@@ -449,7 +725,7 @@ METH_IMPL_rest(String, del, ns) {
     }
 
     zchar *chars = allocArray(size);
-    arrayFromZstring(chars, info->s);
+    arrayFromZstring(chars, getString(ths));
 
     zint at = 0;
     for (zint i = 0; i < size; i++) {
@@ -472,7 +748,7 @@ METH_IMPL_rest(String, del, ns) {
     }
 
     // Construct a new instance with the remaining characters.
-    zvalue result = stringFromZstring((zstring) {at, chars});
+    zvalue result = stringFromZstring(zstringFromZchars(at, chars));
     freeArray(chars);
     return result;
 }
@@ -498,17 +774,18 @@ METH_IMPL_0(String, fetch) {
 
 // Documented in spec.
 METH_IMPL_0_opt(String, forEach, function) {
-    StringInfo *info = getInfo(ths);
-    zstring s = info->s;
+    zstring s = getString(ths);
     zvalue result = NULL;
 
     if (function == NULL) {
         // Without a function, this method just returns the last element.
-        return (s.size == 0) ? NULL : stringFromZchar(s.chars[s.size - 1]);
+        return (s.size == 0)
+            ? NULL
+            : stringFromZchar(zstringNth(s, s.size - 1));
     }
 
     for (zint i = 0; i < s.size; i++) {
-        zvalue v = FUN_CALL(function, stringFromZchar(s.chars[i]));
+        zvalue v = FUN_CALL(function, stringFromZchar(zstringNth(s, i)));
         if (v != NULL) {
             result = v;
         }
@@ -522,6 +799,8 @@ METH_IMPL_0(String, gcMark) {
     StringInfo *info = getInfo(ths);
 
     datMark(info->contentString);
+    datMark(info->left);
+    datMark(info->right);
     return NULL;
 }
 
@@ -549,8 +828,7 @@ METH_IMPL_1(String, nextValue, box) {
             // The hard case. Make a single-character string for the yield.
             // Make an indirect string for the return value, to avoid the
             // churn of copying and re-re-...-copying the content.
-            const zchar *chars = info->s.chars;
-            cm_store(box, stringFromZchar(chars[0]));
+            cm_store(box, stringFromZchar(zstringNth(getString(ths), 0)));
             return makeIndirectString(ths, 1, size - 1);
         }
     }
@@ -565,12 +843,11 @@ METH_IMPL_1(String, nth, n) {
         return NULL;
     }
 
-    return stringFromZchar(info->s.chars[index]);
+    return stringFromZchar(zstringNth(getString(ths), index));
 }
 
 // Documented in spec.
 METH_IMPL_1(String, repeat, count) {
-    StringInfo *thsInfo = getInfo(ths);
     zint n = zintFromInt(count);
 
     if (n < 0) {
@@ -579,13 +856,13 @@ METH_IMPL_1(String, repeat, count) {
         return EMPTY_STRING;
     }
 
-    zint thsSize = thsInfo->s.size;
-    zint size = n * thsSize;
-    zvalue result = allocString(size);
+    zstring s = getString(ths);
+    zint thsBytes = s.size * s.width;
+    zvalue result = allocString(n * s.size, s.width);
     StringInfo *info = getInfo(result);
 
     for (zint i = 0; i < n; i++) {
-        utilCpy(zchar, &info->content[i * thsSize], thsInfo->s.chars, thsSize);
+        utilCpy(uint8_t, &info->content[i * thsBytes], s.chars, thsBytes);
     }
 
     return result;
@@ -593,16 +870,14 @@ METH_IMPL_1(String, repeat, count) {
 
 // Documented in spec.
 METH_IMPL_0(String, reverse) {
-    StringInfo *info = getInfo(ths);
-    zint size = info->s.size;
-    const zchar *chars = info->s.chars;
-    zchar *arr = allocArray(size);
+    zstring s = getString(ths);
+    zchar *arr = allocArray(s.size);
 
-    for (zint i = 0, j = size - 1; i < size; i++, j--) {
-        arr[i] = chars[j];
+    for (zint i = 0, j = s.size - 1; i < s.size; i++, j--) {
+        arr[i] = zstringNth(s, j);
     }
 
-    zvalue result = stringFromZstring((zstring) {size, arr});
+    zvalue result = stringFromZstring(zstringFromZchars(s.size, arr));
     freeArray(arr);
     return result;
 }
@@ -619,16 +894,14 @@ METH_IMPL_1_opt(String, sliceInclusive, start, end) {
 
 // Documented in spec.
 METH_IMPL_0(String, valueList) {
-    StringInfo *info = getInfo(ths);
-    zint size = info->s.size;
-    const zchar *chars = info->s.chars;
-    zvalue result[size];
+    zstring s = getString(ths);
+    zvalue result[s.size];
 
-    for (zint i = 0; i < size; i++) {
-        result[i] = stringFromZchar(chars[i]);
+    for (zint i = 0; i < s.size; i++) {
+        result[i] = stringFromZchar(zstringNth(s, i));
     }
 
-    return listFromZarray((zarray) {size, result});
+    return listFromZarray((zarray) {s.size, result});
 }
 
 /** Initializes the module. */
@@ -662,7 +935,9 @@ MOD_INIT(String) {
             SYM(reverseNth),   FUN_Sequence_reverseNth,
             SYM(sliceGeneral), FUN_Sequence_sliceGeneral));
 
-    EMPTY_STRING = datImmortalize(allocString(0));
+    classSetThreadSafeGcMark(CLS_String);
+
+    EMPTY_STRING = datImmortalize(allocString(0, 1));
 }
 
 // Documented in header.
@@ -16,31 +16,70 @@
 // Private Definitions
 //
 
-/** Array of all symbols, in index order. */
-static zvalue theSymbols[DAT_MAX_SYMBOLS];
+/**
+ * Array of all symbols, in index order. Elements for indices which are
+ * not in use (see `theFreeIndices`) are `NULL`.
+ */
+static zvalue *theSymbols = NULL;
+
+/** One more than the highest symbol index ever assigned. */
+static zint theSymbolsSize = 0;
+
+/** How many symbols `theSymbols` can hold, before needing to grow. */
+static zint theSymbolsMax = 0;
+
+/**
+ * Indices of symbols which have been freed, which get reused before any
+ * new indices are assigned.
+ */
+static zint *theFreeIndices = NULL;
+
+/** The number of elements in `theFreeIndices`. */
+static zint theFreeIndicesSize = 0;
+
+/** How many indices `theFreeIndices` can hold, before needing to grow. */
+static zint theFreeIndicesMax = 0;
+
+/**
+ * Indices of all unlisted symbols. Unlisted symbols aren't immortal, so
+ * these get checked after every gc, to find the ones that got freed.
+ */
+static zint *theUnlisted = NULL;
+
+/** The number of elements in `theUnlisted`. */
+static zint theUnlistedSize = 0;
 
-/** Next symbol index to assign. */
-static zint theNextIndex = 0;
+/** How many indices `theUnlisted` can hold, before needing to grow. */
+static zint theUnlistedMax = 0;
 
-/** Array of all interned symbols, in sort order (possibly stale). */
-static zvalue theInternedSymbols[DAT_MAX_SYMBOLS];
+/**
+ * Hashtable of all interned symbols, keyed by name and using open
+ * addressing. Empty slots are `NULL`.
+ */
+static zvalue *theInternTable = NULL;
 
-/** The number of interned symbols. */
-static zint theInternedSymbolCount = 0;
+/** The number of symbols in `theInternTable`. */
+static zint theInternTableSize = 0;
 
-/** Whether `theInternedSymbols` needs a sort. */
-static bool theNeedSort = false;
+/**
+ * How many slots `theInternTable` has. This is always a power of two, and
+ * the table is always kept at least half empty.
+ */
+static zint theInternTableMax = 0;
 
 /**
  * Symbol structure.
  */
 typedef struct {
-    /** Index of the symbol. No two symbols have the same index. */
+    /** Index of the symbol. No two live symbols have the same index. */
     zint index;
 
     /** Whether this instance is interned. */
     bool interned;
 
+    /** Hash of the symbol's name. See `hashName()`. */
+    uint32_t hash;
+
     /**
      * Name of the symbol. `chars` points at the actual array built into
      * this object.
@@ -48,7 +87,7 @@ typedef struct {
     zstring s;
 
     /** Characters of the symbol's name. */
-    zchar chars[DAT_MAX_SYMBOL_SIZE];
+    zchar chars[/*s.size*/];
 } SymbolInfo;
 
 /**
@@ -68,91 +107,182 @@ static bool uncheckedEq(zvalue symbol1, zvalue symbol2) {
 }
 
 /**
- * Creates and returns a new symbol with the given name. Checks that the
- * size of the name is acceptable and that there aren't already too many
- * symbols. Does no other checking.
+ * Appends the given index to the given growable array, growing it if
+ * necessary.
  */
-static zvalue makeSymbol0(zstring name, bool interned) {
-    if (theNextIndex >= DAT_MAX_SYMBOLS) {
-        die("Too many symbols!");
-    } else if (name.size > DAT_MAX_SYMBOL_SIZE) {
-        die("Symbol name too long: \"%s\"", utf8DupFromZstring(name));
+static void indexArrayPush(zint **array, zint *size, zint *max,
+        zint index) {
+    if (*size == *max) {
+        zint newMax = (*max == 0) ? DAT_SYMBOLS_MIN_SIZE : *max * 2;
+        zint *newArray = utilAlloc(newMax * sizeof(zint));
+
+        utilCpy(zint, newArray, *array, *size);
+        utilFree(*array);
+        *array = newArray;
+        *max = newMax;
     }
 
-    zvalue result = datAllocValue(CLS_Symbol, sizeof(SymbolInfo));
-    SymbolInfo *info = getInfo(result);
-
-    info->index = theNextIndex;
-    info->interned = interned;
-    info->s.size = name.size;
-    info->s.chars = info->chars;
-    utilCpy(zchar, info->chars, name.chars, name.size);
+    (*array)[*size] = index;
+    (*size)++;
+}
 
-    theSymbols[theNextIndex] = result;
-    theNextIndex++;
+/**
+ * Gets the hash of the given name (FNV-1a, over its characters).
+ */
+static uint32_t hashName(zstring name) {
+    uint32_t result = 0x811c9dc5;
 
-    if (interned) {
-        theInternedSymbols[theInternedSymbolCount] = result;
-        theInternedSymbolCount++;
-        theNeedSort = true;
+    for (zint i = 0; i < name.size; i++) {
+        result = (result ^ zstringNth(name, i)) * 0x01000193;
     }
 
-    datImmortalize(result);
     return result;
 }
 
 /**
- * Compares two symbols for index order. Used for sorting.
+ * Finds the slot in `theInternTable` for the given name, with the given
+ * hash. The result is either the slot holding the symbol with that name,
+ * or the (empty) slot where such a symbol belongs.
  */
-static int indexOrder(const void *ptr1, const void *ptr2) {
-    zvalue sym1 = *(zvalue *) ptr1;
-    zvalue sym2 = *(zvalue *) ptr2;
+static zvalue *findSlot(zstring name, uint32_t hash) {
+    zint mask = theInternTableMax - 1;
 
-    if (uncheckedEq(sym1, sym2)) {
-        return 0;
+    for (zint i = hash & mask; /*i*/; i = (i + 1) & mask) {
+        zvalue one = theInternTable[i];
+
+        if (one == NULL) {
+            return &theInternTable[i];
+        }
+
+        SymbolInfo *info = getInfo(one);
+
+        if ((info->hash == hash) && zstringEq(info->s, name)) {
+            return &theInternTable[i];
+        }
     }
+}
 
-    zint idx1 = getInfo(sym1)->index;
-    zint idx2 = getInfo(sym2)->index;
+/**
+ * Adds the given (new) symbol to `theInternTable`, growing the table if
+ * necessary.
+ */
+static void addInterned(zvalue symbol) {
+    if ((theInternTableSize * 2) >= theInternTableMax) {
+        zvalue *oldTable = theInternTable;
+        zint oldMax = theInternTableMax;
+
+        theInternTableMax =
+            (oldMax == 0) ? DAT_SYMBOLS_MIN_SIZE : oldMax * 2;
+        theInternTable = utilAlloc(theInternTableMax * sizeof(zvalue));
+
+        for (zint i = 0; i < oldMax; i++) {
+            zvalue one = oldTable[i];
+            if (one != NULL) {
+                SymbolInfo *info = getInfo(one);
+                *findSlot(info->s, info->hash) = one;
+            }
+        }
 
-    return (idx1 < idx2) ? -1 : 1;
+        utilFree(oldTable);
+    }
+
+    SymbolInfo *info = getInfo(symbol);
+    *findSlot(info->s, info->hash) = symbol;
+    theInternTableSize++;
+}
+
+/**
+ * Assigns an index for a new symbol, and stores the symbol at that index
+ * in `theSymbols`. Freed indices get reused first.
+ */
+static zint assignIndex(zvalue symbol) {
+    zint result;
+
+    if (theFreeIndicesSize != 0) {
+        theFreeIndicesSize--;
+        result = theFreeIndices[theFreeIndicesSize];
+    } else {
+        if (theSymbolsSize == theSymbolsMax) {
+            zint newMax = (theSymbolsMax == 0)
+                ? DAT_SYMBOLS_MIN_SIZE
+                : theSymbolsMax * 2;
+            zvalue *newSymbols = utilAlloc(newMax * sizeof(zvalue));
+
+            utilCpy(zvalue, newSymbols, theSymbols, theSymbolsSize);
+            utilFree(theSymbols);
+            theSymbols = newSymbols;
+            theSymbolsMax = newMax;
+        }
+
+        result = theSymbolsSize;
+        theSymbolsSize++;
+    }
+
+    theSymbols[result] = symbol;
+    return result;
 }
 
 /**
- * Compares two symbols for name order. Used for sorting.
+ * Checks that the given size is acceptable for a symbol name.
  */
-static int sortOrder(const void *vptr1, const void *vptr2) {
-    zvalue v1 = *(zvalue *) vptr1;
-    zvalue v2 = *(zvalue *) vptr2;
-    return zstringOrder(getInfo(v1)->s, getInfo(v2)->s);
+static void checkNameSize(zint size) {
+    if (size > DAT_MAX_SYMBOL_SIZE) {
+        die("Symbol name too long: %lld characters", size);
+    }
 }
 
 /**
- * Compares a name with a symbol. Used for searching.
+ * Creates and returns a new symbol with the given name and hash. Checks
+ * that the size of the name is acceptable. Does no other checking.
+ * Interned symbols are immortal. Unlisted symbols are not, and get
+ * tracked so that their indices can be reused once they are freed.
  */
-static int searchOrder(const void *key, const void *vptr) {
-    const zstring *name = (const zstring *) key;
-    zvalue symbol = *(zvalue *) vptr;
+static zvalue makeSymbol0(zstring name, uint32_t hash, bool interned) {
+    checkNameSize(name.size);
+
+    zvalue result = datAllocValue(CLS_Symbol,
+        sizeof(SymbolInfo) + name.size * sizeof(zchar));
+    SymbolInfo *info = getInfo(result);
+
+    info->index = assignIndex(result);
+    info->interned = interned;
+    info->hash = hash;
+    info->s = zstringFromZchars(name.size, info->chars);
+    arrayFromZstring(info->chars, name);
+
+    if (interned) {
+        addInterned(result);
+        datImmortalize(result);
+    } else {
+        indexArrayPush(&theUnlisted, &theUnlistedSize, &theUnlistedMax,
+            info->index);
+    }
 
-    return zstringOrder(*name, getInfo(symbol)->s);
+    return result;
 }
 
 /**
- * Finds an existing interned symbol with the given name, if any.
+ * Creates and returns a new unlisted symbol with the given name.
  */
-static zvalue findInternedSymbol(zstring name) {
-    if (theNeedSort) {
-        mergesort(
-            theInternedSymbols, theInternedSymbolCount,
-            sizeof(zvalue), sortOrder);
-        theNeedSort = false;
+static zvalue makeUnlisted(zstring name) {
+    return makeSymbol0(name, hashName(name), false);
+}
+
+/**
+ * Compares two symbols for index order. Used for sorting.
+ */
+static int indexOrder(const void *ptr1, const void *ptr2) {
+    zvalue sym1 = *(zvalue *) ptr1;
+    zvalue sym2 = *(zvalue *) ptr2;
+
+    if (uncheckedEq(sym1, sym2)) {
+        return 0;
     }
 
-    zvalue *found = (zvalue *) bsearch(
-        &name, theInternedSymbols, theInternedSymbolCount,
-        sizeof(zvalue), searchOrder);
+    zint idx1 = getInfo(sym1)->index;
+    zint idx2 = getInfo(sym2)->index;
 
-    return (found == NULL) ? NULL : *found;
+    return (idx1 < idx2) ? -1 : 1;
 }
 
 /**
@@ -161,19 +291,47 @@ static zvalue findInternedSymbol(zstring name) {
  */
 static zvalue anySymbolFromUtf8(zint utfBytes, const char *utf,
         bool interned) {
-    zchar chars[DAT_MAX_SYMBOLS];
-    zstring name = {utf8DecodeStringSize(utfBytes, utf), chars};
+    zint size = utf8DecodeStringSize(utfBytes, utf);
+    checkNameSize(size);
+
+    zchar chars[size];
+    zstring name = zstringFromZchars(size, chars);
 
     utf8DecodeCharsFromString(chars, utfBytes, utf);
 
     if (interned) {
         return symbolFromZstring(name);
     } else {
-        return makeSymbol0(name, false);
+        return makeUnlisted(name);
     }
 }
 
 
+//
+// Module Definitions
+//
+
+// Documented in header.
+void symbolPruneUnlisted(void) {
+    zint at = 0;
+
+    for (zint i = 0; i < theUnlistedSize; i++) {
+        zint index = theUnlisted[i];
+
+        if (gcIsMarked(theSymbols[index])) {
+            theUnlisted[at] = index;
+            at++;
+        } else {
+            theSymbols[index] = NULL;
+            indexArrayPush(&theFreeIndices, &theFreeIndicesSize,
+                &theFreeIndicesMax, index);
+        }
+    }
+
+    theUnlistedSize = at;
+}
+
+
 //
 // Exported Definitions
 //
@@ -198,7 +356,7 @@ zvalue symbolCat(zvalue symbol1, zvalue symbol2) {
     arrayFromZstring(chars, info1->s);
     arrayFromZstring(&chars[size1], info2->s);
 
-    return symbolFromZstring((zstring) {size, chars});
+    return symbolFromZstring(zstringFromZchars(size, chars));
 }
 
 // Documented in header.
@@ -210,11 +368,15 @@ bool symbolEq(zvalue symbol1, zvalue symbol2) {
 
 // Documented in header.
 zvalue symbolFromIndex(zint index) {
-    if ((index < 0) || (index >= theNextIndex)) {
+    zvalue result = ((index < 0) || (index >= theSymbolsSize))
+        ? NULL
+        : theSymbols[index];
+
+    if (result == NULL) {
         die("Bad index for symbol: %lld", index);
     }
 
-    return theSymbols[index];
+    return result;
 }
 
 // Documented in header.
@@ -238,8 +400,21 @@ zvalue symbolFromZorder(zorder order) {
 
 // Documented in header.
 zvalue symbolFromZstring(zstring name) {
-    zvalue result = findInternedSymbol(name);
-    return (result != NULL) ? result : makeSymbol0(name, true);
+    uint32_t hash = hashName(name);
+
+    if (theInternTable != NULL) {
+        zvalue result = *findSlot(name, hash);
+        if (result != NULL) {
+            return result;
+        }
+    }
+
+    return makeSymbol0(name, hash, true);
+}
+
+// Documented in header.
+zint symbolIndexLimit(void) {
+    return theSymbolsSize;
 }
 
 // Documented in header.
@@ -309,7 +484,7 @@ METH_IMPL_rest(Symbol, cat, args) {
         at += strings[i].size;
     }
 
-    return symbolFromZstring((zstring) {size, chars});
+    return symbolFromZstring(zstringFromZchars(size, chars));
 }
 
 // Documented in spec.
@@ -369,7 +544,7 @@ METH_IMPL_0(Symbol, isInterned) {
 // Documented in spec.
 METH_IMPL_0(Symbol, toUnlisted) {
     SymbolInfo *info = getInfo(ths);
-    return makeSymbol0(info->s, false);
+    return makeSymbol0(info->s, info->hash, false);
 }
 
 // Documented in header.
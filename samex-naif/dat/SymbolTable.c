@@ -514,6 +514,8 @@ void bindMethodsForSymbolTable(void) {
             METH_BIND(SymbolTable, get),
             METH_BIND(SymbolTable, get_size)));
 
+    classSetThreadSafeGcMark(CLS_SymbolTable);
+
     EMPTY_SYMBOL_TABLE = datImmortalize(allocInstance(0));
 }
 
@@ -25,6 +25,9 @@ void datNonVoidError(void) {
     die("Attempt to use void in non-void context.");
 }
 
+// This provides the non-inline version of this function.
+extern bool datIsImmediateInt(zvalue value);
+
 // This provides the non-inline version of this function.
 extern void *datPayload(zvalue value);
 
@@ -2,9 +2,15 @@
 // Licensed AS IS and WITHOUT WARRANTY under the Apache License,
 // Version 2.0. Details: <http://www.apache.org/licenses/LICENSE-2.0>
 
-#include <time.h>  // Used for "chatty gc."
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
 
 #include "type/Class.h"
+#include "type/Symbol.h"
 #include "type/Value.h"
 
 #include "impl.h"
@@ -14,173 +20,1312 @@
 // Private Definitions
 //
 
-/** Array of all immortal values. */
-static zvalue immortals[DAT_MAX_IMMORTALS];
+enum {
+    /** Number of bits in a bitmap word. */
+    BITS_PER_WORD = 64,
+
+    /** Number of granules in a (non-large) segment. */
+    SEGMENT_GRANULES = DAT_SEGMENT_SIZE / DAT_GRANULE_SIZE,
+
+    /** Number of words in each segment bitmap. */
+    BITMAP_WORDS = SEGMENT_GRANULES / BITS_PER_WORD
+};
+
+/**
+ * Cell sizes (in bytes) of each of the size classes. The spacing is one
+ * granule up through 128 bytes, which covers the most common values
+ * exactly (e.g. `Int` is 24 bytes, `Box` 32, `Record` 40, and short
+ * `List`s and `String`s a bit more). After that, it's four classes per
+ * doubling.
+ */
+static const zint CLASS_SIZES[] = {
+    16,    24,    32,    40,    48,    56,    64,    72,
+    80,    88,    96,    104,   112,   120,   128,
+    160,   192,   224,   256,   320,   384,   448,   512,
+    640,   768,   896,   1024,  1280,  1536,  1792,  2048,
+    2560,  3072,  3584,  4096,  5120,  6144,  7168,  8192,
+    10240, 12288, 14336, DAT_MAX_CELL_SIZE
+};
+
+/** Number of size classes which are spaced one granule apart. */
+#define SMALL_CLASS_COUNT 15
+
+/** Number of size classes. */
+#define SIZE_CLASS_COUNT ((zint) (sizeof(CLASS_SIZES) / sizeof(zint)))
+
+/**
+ * Heap segment. Each segment is a `DAT_SEGMENT_SIZE`-aligned block of
+ * memory, holding this header followed by a series of equal-size cells
+ * (or, for a large segment, a single cell of arbitrary size). Liveness
+ * is tracked on the side, in bitmaps with one bit per granule of the
+ * segment. Only the bit for the first granule of each cell is ever used.
+ */
+typedef struct Segment {
+    /** Next segment in the same list (size class or large list). */
+    struct Segment *next;
+
+    /** Index into `sizeClasses`, or `-1` if this is a large segment. */
+    zint sizeClass;
+
+    /** Size of each cell, in bytes. */
+    zint cellSize;
+
+    /** Number of cells. */
+    zint cellCount;
+
+    /** Number of cells currently allocated. */
+    zint usedCount;
+
+    /**
+     * Whether this segment is part of the sealed space (see
+     * `datSealHeap()`). Sealed segments are never swept, and their mark
+     * bits are never cleared.
+     */
+    bool sealed;
+
+    /** Start of the first cell. */
+    char *cells;
+
+    /** Allocation bitmap. A bit is set for each allocated cell. */
+    uint64_t used[BITMAP_WORDS];
+
+    /**
+     * Mark bitmap. A bit is set for each cell that has survived a gc.
+     * These bits are "sticky" across minor gcs, and in effect identify the
+     * old generation. They get cleared at the start of each major gc.
+     */
+    uint64_t marks[BITMAP_WORDS];
+} Segment;
+
+/**
+ * Free cell. Free cells are threaded together, with the links stored in
+ * the cells themselves.
+ */
+typedef struct FreeCell {
+    /** Next free cell. */
+    struct FreeCell *next;
+} FreeCell;
+
+/**
+ * Backing array for a mark deque (see `MarkWorker`).
+ */
+typedef struct DequeArray {
+    /**
+     * Array that this one replaced, if any. Replaced arrays are kept around
+     * until the end of the parallel mark, since thieves may still be
+     * reading from them.
+     */
+    struct DequeArray *prev;
+
+    /** Capacity, in elements. Always a power of two. */
+    zint capacity;
+
+    /** Elements, indexed by deque index modulo `capacity`. */
+    zvalue elems[];
+} DequeArray;
+
+/**
+ * Parallel mark worker, one per gc thread. Each has a work-stealing deque
+ * of marked values whose innards have yet to be marked. The owning thread
+ * pushes and takes at the bottom, and other threads steal from the top.
+ * This is the Chase-Lev deque, as adapted to C11-style atomics in
+ * "Correct and Efficient Work-Stealing for Weak Memory Models" (Lê et al.).
+ */
+typedef struct {
+    /** Deque index of the next element to steal. */
+    zint top;
+
+    /** Deque index just past the most recently pushed element. */
+    zint bottom;
+
+    /** Deque backing array. */
+    DequeArray *array;
+
+    /** Number of values processed by this worker, in the current mark. */
+    zint markCount;
+
+    /** Thread running this worker. Unused for worker `0` (the main thread). */
+    pthread_t thread;
+} __attribute__((aligned(64))) MarkWorker;
+
+/**
+ * Per-size-class allocation state.
+ */
+typedef struct {
+    /** List of all segments of this size class. */
+    Segment *segments;
+
+    /**
+     * Next segment to look for free cells in, once `freeList` runs out.
+     * `NULL` means a new segment is needed.
+     */
+    Segment *refillNext;
+
+    /** Free list, that is, cells ready to be allocated. */
+    FreeCell *freeList;
+} SizeClass;
+
+/** Offset from the start of a segment to its first cell. */
+#define CELLS_OFFSET \
+    ((zint) ((sizeof(Segment) + DAT_GRANULE_SIZE - 1) \
+        & ~(DAT_GRANULE_SIZE - 1)))
+
+/** Array of all immortal values, other than sealed ones. */
+static zvalue *immortals = NULL;
 
 /** How many immortal values there are right now. */
 static zint immortalsSize = 0;
 
-/** List head for the list of all live values. Double-linked circular list. */
-static DatHeader liveHead = {
-    .next = &liveHead,
-    .prev = &liveHead,
-    .mark = MARK_AZURE,
-    .cls = NULL
-};
+/** How many values `immortals` can hold, before needing to grow. */
+static zint immortalsMax = 0;
+
+/** Allocation state for each size class. */
+static SizeClass sizeClasses[SIZE_CLASS_COUNT];
+
+/** List of all large (single-value) segments. */
+static Segment *largeSegments = NULL;
+
+/** List of all sealed segments (see `datSealHeap()`). */
+static Segment *sealedSegments = NULL;
+
+/**
+ * Rescan set, that is, the sealed values which have had references
+ * stored into them since they were sealed. These are treated as additional
+ * roots during major gc. Values never leave this set.
+ */
+static zvalue *rescan = NULL;
+
+/** How many values are in the rescan set right now. */
+static zint rescanSize = 0;
+
+/** How many values the rescan set can hold, before needing to grow. */
+static zint rescanMax = 0;
+
+/**
+ * Mark stack, that is, the values that have been marked but whose
+ * innards have yet to be marked.
+ */
+static zvalue *markStack = NULL;
+
+/** How many values are on the mark stack right now. */
+static zint markStackSize = 0;
+
+/** How many values the mark stack can hold, before needing to grow. */
+static zint markStackMax = 0;
+
+/**
+ * Remembered set, that is, the old-generation values which have had
+ * references stored into them since the last gc. These are treated as
+ * additional roots during minor gc.
+ */
+static zvalue *remembered = NULL;
+
+/** How many values are in the remembered set right now. */
+static zint rememberedSize = 0;
+
+/** How many values the remembered set can hold, before needing to grow. */
+static zint rememberedMax = 0;
+
+/**
+ * Number of bytes to allocate between gcs, that is, the size of the
+ * nursery. Set up by `initGcParams()`. Until then, this is `0`, which is
+ * how the first allocation knows to call `initGcParams()`.
+ */
+static zint nurseryBytes = 0;
+
+/** Minimum value of `majorGcBytes`. Set up by `initGcParams()`. */
+static zint minHeapBytes = 0;
+
+/**
+ * Percentage of the bytes live after a major gc, which the heap is allowed
+ * to grow to before the next major gc. Set up by `initGcParams()`.
+ */
+static zint heapGrowthPercent = 0;
+
+/**
+ * Number of live bytes in the heap (as of the last gc) above which the next
+ * gc will be a major one.
+ */
+static zint majorGcBytes = 0;
+
+/** Number of bytes allocated since the last garbage collection. */
+static zint allocatedBytes = 0;
+
+/** Number of bytes in the heap that survived the last garbage collection. */
+static zint liveBytes = 0;
+
+/**
+ * Number of threads to mark with. Set up by `initGcParams()`. If this is
+ * `1`, then marking is done serially on the main thread, and none of the
+ * parallel mark machinery is used.
+ */
+static zint gcThreads = 0;
+
+/** Parallel mark workers. Set up on first use, with `gcThreads` elements. */
+static MarkWorker *workers = NULL;
+
+/**
+ * The worker for the current thread, during a parallel mark. `NULL` at all
+ * other times, including during serial marking.
+ */
+static __thread MarkWorker *currentWorker = NULL;
+
+/** Number of workers that have run out of work, during a parallel mark. */
+static zint idleWorkers = 0;
+
+/** Lock which serializes calls to non-thread-safe `gcMark` methods. */
+static pthread_mutex_t gcMarkLock = PTHREAD_MUTEX_INITIALIZER;
+
+/** Lock for starting and finishing parallel marks. */
+static pthread_mutex_t markLock = PTHREAD_MUTEX_INITIALIZER;
+
+/** Condition for changes to `markGeneration` and `activeHelpers`. */
+static pthread_cond_t markCond = PTHREAD_COND_INITIALIZER;
+
+/** Parallel mark counter. Helper threads start marking when it changes. */
+static zint markGeneration = 0;
+
+/** Number of helper threads still working on the current parallel mark. */
+static zint activeHelpers = 0;
+
+/** Number of gcs performed. */
+static zint gcCount = 0;
+
+/** Total number live objects. Only used when being chatty. */
+static zint liveCount = 0;
+
+/**
+ * Per-class allocation statistics. This is an open-addressed hash table
+ * keyed by class, with `NULL` classes indicating empty entries. It holds
+ * its classes weakly (see `pruneClassStats()`).
+ */
+static DatClassStats *classStats = NULL;
+
+/** How many entries of `classStats` are in use. */
+static zint classStatsSize = 0;
+
+/** How many entries `classStats` has. Always a power of two (or `0`). */
+static zint classStatsMax = 0;
+
+/** Combined allocation statistics of all classes that have been freed. */
+static DatClassStats freedClassStats = { NULL, 0, 0 };
+
+/** Number of values ever allocated. */
+static zint allocCount = 0;
+
+/** Number of bytes ever allocated. */
+static zint allocBytes = 0;
+
+/** Number of major gcs performed. */
+static zint majorGcCount = 0;
+
+/** Total time spent in gc, in microseconds. */
+static zint totalPauseUsec = 0;
+
+/** Longest single gc, in microseconds. */
+static zint maxPauseUsec = 0;
+
+/** Histogram of gc times. See `DAT_GC_PAUSE_BUCKETS`. */
+static zint pauseHistogram[DAT_GC_PAUSE_BUCKETS];
+
+/** Number of bytes of values that were sealed (see `datSealHeap()`). */
+static zint sealedBytes = 0;
+
+/** Largest number of bytes ever live after a gc, including sealed bytes. */
+static zint peakLiveBytes = 0;
+
+/**
+ * Information about the most recent gcs, as a ring buffer indexed by
+ * `gcCount`.
+ */
+static DatGcCycle gcHistory[DAT_GC_HISTORY_SIZE];
+
+/**
+ * Gets the segment that the given value was allocated in.
+ */
+static Segment *segmentOf(zvalue value) {
+    return (Segment *) ((intptr_t) value & ~((intptr_t) DAT_SEGMENT_SIZE - 1));
+}
+
+/**
+ * Gets the bitmap index for the given value, within the given segment.
+ */
+static zint bitIndexOf(Segment *segment, zvalue value) {
+    return ((char *) value - (char *) segment) / DAT_GRANULE_SIZE;
+}
+
+/**
+ * Gets the bit at the given index of the given bitmap.
+ */
+static bool bitGet(const uint64_t *bitmap, zint index) {
+    return (bitmap[index / BITS_PER_WORD] >> (index % BITS_PER_WORD)) & 1;
+}
+
+/**
+ * Sets the bit at the given index of the given bitmap.
+ */
+static void bitSet(uint64_t *bitmap, zint index) {
+    bitmap[index / BITS_PER_WORD] |= ((uint64_t) 1) << (index % BITS_PER_WORD);
+}
+
+/**
+ * Returns whether the given value is currently allocated.
+ */
+static bool isAllocated(zvalue value) {
+    Segment *segment = segmentOf(value);
+    return bitGet(segment->used, bitIndexOf(segment, value));
+}
+
+/**
+ * Returns whether the given value is marked. Outside of a major gc, this
+ * is the same as asking whether the value is in the old generation.
+ */
+static bool isMarked(zvalue value) {
+    Segment *segment = segmentOf(value);
+    return bitGet(segment->marks, bitIndexOf(segment, value));
+}
+
+/**
+ * Gets the size class index for the given allocation size in bytes, or
+ * `-1` if the size is too large for any size class.
+ */
+static zint sizeClassFor(zint size) {
+    zint granules = (size + DAT_GRANULE_SIZE - 1) / DAT_GRANULE_SIZE;
+
+    if (granules <= SMALL_CLASS_COUNT + 1) {
+        // The smallest cell size is two granules.
+        return (granules <= 2) ? 0 : granules - 2;
+    }
+
+    for (zint i = SMALL_CLASS_COUNT; i < SIZE_CLASS_COUNT; i++) {
+        if (CLASS_SIZES[i] >= size) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * Gets the total size in bytes of the given segment.
+ */
+static zint segmentSize(Segment *segment) {
+    return (segment->sizeClass < 0)
+        ? CELLS_OFFSET + segment->cellSize
+        : DAT_SEGMENT_SIZE;
+}
+
+/**
+ * Allocates and initializes a new segment. `sizeClass` is `-1` to indicate
+ * a large segment, in which case `cellSize` is the size of its one cell.
+ */
+static Segment *newSegment(zint sizeClass, zint cellSize) {
+    zint totalSize;
+    zint cellCount;
+
+    if (sizeClass < 0) {
+        totalSize = CELLS_OFFSET + cellSize;
+        cellCount = 1;
+    } else {
+        totalSize = DAT_SEGMENT_SIZE;
+        cellCount = (DAT_SEGMENT_SIZE - CELLS_OFFSET) / cellSize;
+    }
+
+    Segment *result = utilAllocPages(totalSize, DAT_SEGMENT_SIZE);
+
+    result->sizeClass = sizeClass;
+    result->cellSize = cellSize;
+    result->cellCount = cellCount;
+    result->cells = ((char *) result) + CELLS_OFFSET;
+
+    return result;
+}
+
+/**
+ * Allocates a zeroed-out large value, in its own segment.
+ */
+static zvalue allocLarge(zint size) {
+    Segment *segment = newSegment(-1, size);
+    zvalue result = (zvalue) segment->cells;
+
+    allocatedBytes += size;
+    bitSet(segment->used, bitIndexOf(segment, result));
+    segment->usedCount = 1;
+    segment->next = largeSegments;
+    largeSegments = segment;
+
+    return result;
+}
+
+/**
+ * Refills the free list of the given size class, by threading together the
+ * free cells of the next segment that has any. If there is no such segment,
+ * this allocates a new one.
+ */
+static void refillFreeList(zint classIndex) {
+    SizeClass *sc = &sizeClasses[classIndex];
+    Segment *segment;
+
+    for (;;) {
+        segment = sc->refillNext;
+
+        if (segment == NULL) {
+            segment = newSegment(classIndex, CLASS_SIZES[classIndex]);
+            segment->next = sc->segments;
+            sc->segments = segment;
+            break;
+        }
+
+        sc->refillNext = segment->next;
+
+        if (segment->usedCount < segment->cellCount) {
+            break;
+        }
+    }
+
+    // Thread the cells from last to first, so that allocation proceeds
+    // in address order.
+
+    zint cellSize = segment->cellSize;
+    zint stride = cellSize / DAT_GRANULE_SIZE;
+    zint firstBit = CELLS_OFFSET / DAT_GRANULE_SIZE;
+    FreeCell *freeList = NULL;
+
+    for (zint i = segment->cellCount - 1; i >= 0; i--) {
+        if (!bitGet(segment->used, firstBit + (i * stride))) {
+            FreeCell *one = (FreeCell *) (segment->cells + (i * cellSize));
+            one->next = freeList;
+            freeList = one;
+        }
+    }
+
+    sc->freeList = freeList;
+}
+
+/**
+ * Allocates zeroed-out memory for a value of the given size in bytes.
+ */
+static zvalue allocCell(zint size) {
+    zint classIndex = sizeClassFor(size);
+
+    if (classIndex < 0) {
+        return allocLarge(size);
+    }
+
+    SizeClass *sc = &sizeClasses[classIndex];
+
+    if (sc->freeList == NULL) {
+        refillFreeList(classIndex);
+    }
+
+    FreeCell *result = sc->freeList;
+    Segment *segment = segmentOf((zvalue) result);
+
+    sc->freeList = result->next;
+    bitSet(segment->used, bitIndexOf(segment, (zvalue) result));
+    segment->usedCount++;
+    allocatedBytes += segment->cellSize;
+    memset(result, 0, size);
+
+    return (zvalue) result;
+}
+
+/**
+ * Sweeps the given segment, freeing all allocated-but-unmarked cells.
+ * Returns the number of cells freed.
+ */
+static zint sweepSegment(Segment *segment) {
+    zint counter = 0;
+
+    for (zint i = 0; i < BITMAP_WORDS; i++) {
+        uint64_t dead = segment->used[i] & ~segment->marks[i];
+
+        if (dead != 0) {
+            counter += __builtin_popcountll(dead);
+            segment->used[i] ^= dead;
+        }
+    }
+
+    segment->usedCount -= counter;
+    return counter;
+}
+
+/**
+ * Sweeps all the segments on the list with the given head, returning the
+ * number of cells freed. If `freeEmpty` is `true`, then segments that end
+ * up with no allocated cells get freed. Large segments are always freed
+ * when empty.
+ */
+static zint sweepList(Segment **head, bool freeEmpty) {
+    zint counter = 0;
+
+    for (Segment **link = head; *link != NULL; /*link*/) {
+        Segment *segment = *link;
+
+        counter += sweepSegment(segment);
+
+        if ((segment->usedCount == 0)
+            && (freeEmpty || (segment->sizeClass < 0))) {
+            *link = segment->next;
+            utilFreePages(segment, segmentSize(segment));
+        } else {
+            link = &segment->next;
+        }
+    }
+
+    return counter;
+}
+
+/**
+ * Sweeps the entire heap, returning the number of cells freed. This also
+ * resets the allocation state of each size class, dropping the free lists
+ * (whose cells might no longer exist, and which will get rebuilt from the
+ * bitmaps as needed). See `sweepList()` about `freeEmpty`.
+ */
+static zint sweepHeap(bool freeEmpty) {
+    zint counter = sweepList(&largeSegments, true);
+
+    for (zint i = 0; i < SIZE_CLASS_COUNT; i++) {
+        SizeClass *sc = &sizeClasses[i];
+
+        counter += sweepList(&sc->segments, freeEmpty);
+        sc->refillNext = sc->segments;
+        sc->freeList = NULL;
+    }
+
+    return counter;
+}
+
+/**
+ * Gets the total size in bytes of the allocated cells of all the segments
+ * on the list with the given head.
+ */
+static zint countBytesList(Segment *head) {
+    zint result = 0;
+
+    for (Segment *segment = head; segment != NULL; segment = segment->next) {
+        result += segment->usedCount * segment->cellSize;
+    }
+
+    return result;
+}
+
+/**
+ * Gets the total size in bytes of all the allocated cells in the heap.
+ */
+static zint countBytes(void) {
+    zint result = countBytesList(largeSegments);
+
+    for (zint i = 0; i < SIZE_CLASS_COUNT; i++) {
+        result += countBytesList(sizeClasses[i].segments);
+    }
+
+    return result;
+}
+
+/**
+ * Clears all the mark bits of all the segments on the list with the given
+ * head.
+ */
+static void clearMarksList(Segment *head) {
+    for (Segment *segment = head; segment != NULL; segment = segment->next) {
+        memset(segment->marks, 0, sizeof(segment->marks));
+    }
+}
+
+/**
+ * Clears all the mark bits in the heap.
+ */
+static void clearMarks(void) {
+    clearMarksList(largeSegments);
+
+    for (zint i = 0; i < SIZE_CLASS_COUNT; i++) {
+        clearMarksList(sizeClasses[i].segments);
+    }
+}
+
+/**
+ * Returns whether the given pointer is properly aligned to be a
+ * value.
+ */
+static bool isAligned(void *maybeValue) {
+    intptr_t bits = (intptr_t) (void *) maybeValue;
+    return ((bits & (DAT_VALUE_ALIGNMENT - 1)) == 0);
+}
+
+/**
+ * Asserts that the value is valid, with thorough (and slow) checking.
+ */
+static bool thoroughlyValidate(zvalue maybeValue) {
+    if (maybeValue == NULL) {
+        die("Invalid value: NULL");
+    }
+
+    if (!isAligned(maybeValue)) {
+        note("Invalid value (mis-aligned): %p", maybeValue);
+        return false;
+    }
+
+    if (!utilIsHeapAllocated(maybeValue)) {
+        note("Invalid value (not in heap): %p", maybeValue);
+        return false;
+    }
+
+    if (!isAllocated(maybeValue)) {
+        note("Invalid value (not allocated): %p", maybeValue);
+        return false;
+    }
+
+    zvalue cls = maybeValue->cls;
+
+    if ((cls == NULL) && (CLS_Metaclass == NULL)) {
+        // This is the first metaclass, allocated during bootstrap. Its
+        // class gets filled in after `CLS_Metaclass` is set up.
+        return true;
+    }
+
+    if (!(isAligned(cls) && utilIsHeapAllocated(cls) && isAllocated(cls))) {
+        note("Invalid value (invalid class): %p", maybeValue);
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Sanity check all the allocated values in the segments on the list with
+ * the given head.
+ */
+static bool sanityCheckList(Segment *head) {
+    for (Segment *segment = head; segment != NULL; segment = segment->next) {
+        for (zint i = 0; i < segment->cellCount; i++) {
+            zvalue one = (zvalue) (segment->cells + (i * segment->cellSize));
+            if (isAllocated(one) && !thoroughlyValidate(one)) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Sanity check the heap and tables.
+ */
+static void sanityCheck(bool force) {
+    if (!(force || DAT_MEMORY_PARANOIA)) {
+        return;
+    }
+
+    for (zint i = 0; i < immortalsSize; i++) {
+        if (!thoroughlyValidate(immortals[i])) {
+            die("...at immortal #%lld", i);
+        }
+    }
+
+    if (!sanityCheckList(largeSegments)) {
+        die("...in large segment.");
+    }
+
+    if (!sanityCheckList(sealedSegments)) {
+        die("...in sealed segment.");
+    }
+
+    for (zint i = 0; i < SIZE_CLASS_COUNT; i++) {
+        if (!sanityCheckList(sizeClasses[i].segments)) {
+            die("...in size class #%lld.", i);
+        }
+    }
+}
+
+/**
+ * Appends a value to a growable array of values (one of the mark stack,
+ * remembered set, rescan set, or immortals), growing it if necessary.
+ * `minSize` is the size to allocate the first time around.
+ */
+static void valueArrayPush(zvalue **array, zint *size, zint *max,
+        zint minSize, zvalue value) {
+    if (*size == *max) {
+        zint newMax = (*max == 0) ? minSize : *max * 2;
+        zvalue *newArray = utilAlloc(newMax * sizeof(zvalue));
+
+        utilCpy(zvalue, newArray, *array, *size);
+        utilFree(*array);
+        *array = newArray;
+        *max = newMax;
+    }
+
+    (*array)[*size] = value;
+    (*size)++;
+}
+
+/**
+ * Pushes the given value onto the mark stack, growing the stack if
+ * necessary.
+ */
+static void markStackPush(zvalue value) {
+    valueArrayPush(&markStack, &markStackSize, &markStackMax,
+        DAT_MARK_STACK_MIN_SIZE, value);
+}
+
+/**
+ * Atomically sets the mark bit of the given value, returning `true` if
+ * this call is what set it (that is, if it was previously clear).
+ */
+static bool claimMark(zvalue value) {
+    Segment *segment = segmentOf(value);
+    zint index = bitIndexOf(segment, value);
+    uint64_t *word = &segment->marks[index / BITS_PER_WORD];
+    uint64_t bit = ((uint64_t) 1) << (index % BITS_PER_WORD);
+
+    // Check before writing, since most values that get here are already
+    // marked.
+    if ((__atomic_load_n(word, __ATOMIC_RELAXED) & bit) != 0) {
+        return false;
+    }
+
+    return (__atomic_fetch_or(word, bit, __ATOMIC_RELAXED) & bit) == 0;
+}
+
+/**
+ * Allocates a deque array with the given capacity.
+ */
+static DequeArray *newDequeArray(zint capacity) {
+    DequeArray *result =
+        utilAlloc(sizeof(DequeArray) + (capacity * sizeof(zvalue)));
+
+    result->capacity = capacity;
+    return result;
+}
+
+/**
+ * Replaces the deque array of the given worker with one twice the size.
+ * Only ever called by the owning thread. Returns the new array.
+ */
+static DequeArray *growDeque(MarkWorker *worker, DequeArray *array,
+        zint top, zint bottom) {
+    DequeArray *result = newDequeArray(array->capacity * 2);
+    zint oldMask = array->capacity - 1;
+    zint newMask = result->capacity - 1;
+
+    for (zint i = top; i < bottom; i++) {
+        result->elems[i & newMask] = array->elems[i & oldMask];
+    }
+
+    result->prev = array;
+    __atomic_store_n(&worker->array, result, __ATOMIC_RELEASE);
+    return result;
+}
+
+/**
+ * Pushes a value onto the bottom of the given worker's deque. Only ever
+ * called by the owning thread (or before the parallel mark starts).
+ */
+static void dequePush(MarkWorker *worker, zvalue value) {
+    zint bottom = __atomic_load_n(&worker->bottom, __ATOMIC_RELAXED);
+    zint top = __atomic_load_n(&worker->top, __ATOMIC_ACQUIRE);
+    DequeArray *array = __atomic_load_n(&worker->array, __ATOMIC_RELAXED);
+
+    if ((bottom - top) >= array->capacity) {
+        array = growDeque(worker, array, top, bottom);
+    }
+
+    __atomic_store_n(&array->elems[bottom & (array->capacity - 1)], value,
+        __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    __atomic_store_n(&worker->bottom, bottom + 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * Takes a value from the bottom of the given worker's deque, or returns
+ * `NULL` if it is empty. Only ever called by the owning thread.
+ */
+static zvalue dequeTake(MarkWorker *worker) {
+    zint bottom = __atomic_load_n(&worker->bottom, __ATOMIC_RELAXED) - 1;
+    DequeArray *array = __atomic_load_n(&worker->array, __ATOMIC_RELAXED);
+
+    __atomic_store_n(&worker->bottom, bottom, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    zint top = __atomic_load_n(&worker->top, __ATOMIC_RELAXED);
+    zvalue result = NULL;
+
+    if (top <= bottom) {
+        result = __atomic_load_n(&array->elems[bottom & (array->capacity - 1)],
+            __ATOMIC_RELAXED);
+
+        if (top == bottom) {
+            // This is the last element, so race any thieves for it.
+            if (!__atomic_compare_exchange_n(&worker->top, &top, top + 1,
+                    false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+                result = NULL;
+            }
+            __atomic_store_n(&worker->bottom, bottom + 1, __ATOMIC_RELAXED);
+        }
+    } else {
+        __atomic_store_n(&worker->bottom, bottom + 1, __ATOMIC_RELAXED);
+    }
+
+    return result;
+}
+
+/**
+ * Steals a value from the top of the given worker's deque, or returns
+ * `NULL` if it is empty or if another thread won the race for the value.
+ */
+static zvalue dequeSteal(MarkWorker *worker) {
+    zint top = __atomic_load_n(&worker->top, __ATOMIC_ACQUIRE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    zint bottom = __atomic_load_n(&worker->bottom, __ATOMIC_ACQUIRE);
+
+    if (top >= bottom) {
+        return NULL;
+    }
+
+    DequeArray *array = __atomic_load_n(&worker->array, __ATOMIC_ACQUIRE);
+    zvalue result = __atomic_load_n(
+        &array->elems[top & (array->capacity - 1)], __ATOMIC_RELAXED);
+
+    if (!__atomic_compare_exchange_n(&worker->top, &top, top + 1,
+            false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+        return NULL;
+    }
+
+    return result;
+}
+
+/**
+ * Returns whether any worker's deque appears to be non-empty.
+ */
+static bool anyDequeHasWork(void) {
+    for (zint i = 0; i < gcThreads; i++) {
+        MarkWorker *one = &workers[i];
+        if (__atomic_load_n(&one->top, __ATOMIC_ACQUIRE)
+            < __atomic_load_n(&one->bottom, __ATOMIC_ACQUIRE)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * Tries to steal a value from any worker other than the given one,
+ * starting with the one after it. Returns `NULL` if nothing was stolen.
+ */
+static zvalue stealAny(MarkWorker *worker) {
+    zint self = worker - workers;
+
+    for (zint i = 1; i < gcThreads; i++) {
+        zvalue result = dequeSteal(&workers[(self + i) % gcThreads]);
+        if (result != NULL) {
+            return result;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Marks the innards of the given value, during a parallel mark.
+ */
+static void parallelGcMark(zvalue value) {
+    if (classHasThreadSafeGcMark(value->cls)) {
+        callGcMark(value);
+    } else {
+        pthread_mutex_lock(&gcMarkLock);
+        callGcMark(value);
+        pthread_mutex_unlock(&gcMarkLock);
+    }
+}
+
+/**
+ * Runs the given worker for one parallel mark, until all workers have run
+ * out of work.
+ */
+static void runMarkWorker(MarkWorker *worker) {
+    zint counter = 0;
+
+    currentWorker = worker;
+
+    for (;;) {
+        zvalue value;
+
+        while ((value = dequeTake(worker)) != NULL) {
+            parallelGcMark(value);
+            counter++;
+        }
+
+        value = stealAny(worker);
+
+        if (value != NULL) {
+            parallelGcMark(value);
+            counter++;
+            continue;
+        }
+
+        // Out of work. Wait for either more work to show up or all the
+        // other workers to run out too. Because idle workers never push
+        // values, once all workers are idle, there is nothing left to do.
+
+        __atomic_add_fetch(&idleWorkers, 1, __ATOMIC_SEQ_CST);
+
+        for (;;) {
+            if (__atomic_load_n(&idleWorkers, __ATOMIC_SEQ_CST) == gcThreads) {
+                worker->markCount = counter;
+                currentWorker = NULL;
+                return;
+            }
+
+            if (anyDequeHasWork()) {
+                break;
+            }
+
+            sched_yield();
+        }
+
+        __atomic_sub_fetch(&idleWorkers, 1, __ATOMIC_SEQ_CST);
+    }
+}
 
 /**
- * List head for the list of all doomed values. Double-linked circular list.
+ * Main function for helper (non-main) gc threads.
  */
-static DatHeader doomedHead = {
-    .next = &doomedHead,
-    .prev = &doomedHead,
-    .mark = MARK_AZURE,
-    .cls = NULL
-};
+static void *markHelperMain(void *arg) {
+    MarkWorker *worker = arg;
+    zint seenGeneration = 0;
 
-/** Current color that represents live values. */
-static zmarkColor liveColor = MARK_MAUVE;
+    profileBlockThread();
 
-/** Number of allocations since the last garbage collection. */
-static zint allocationCount = 0;
+    for (;;) {
+        pthread_mutex_lock(&markLock);
+        while (markGeneration == seenGeneration) {
+            pthread_cond_wait(&markCond, &markLock);
+        }
+        seenGeneration = markGeneration;
+        pthread_mutex_unlock(&markLock);
 
-/** Number of gcs performed. */
-static zint gcCount = 0;
+        runMarkWorker(worker);
 
-/** Total number live objects. Only used when being chatty. */
-static zint liveCount = 0;
+        pthread_mutex_lock(&markLock);
+        activeHelpers--;
+        if (activeHelpers == 0) {
+            pthread_cond_broadcast(&markCond);
+        }
+        pthread_mutex_unlock(&markLock);
+    }
+
+    return NULL;
+}
 
 /**
- * Returns whether the given pointer is properly aligned to be a
- * value.
+ * Sets up the mark workers, including starting the helper threads.
  */
-static bool isAligned(void *maybeValue) {
-    intptr_t bits = (intptr_t) (void *) maybeValue;
-    return ((bits & (DAT_VALUE_ALIGNMENT - 1)) == 0);
+static void initWorkers(void) {
+    workers = utilAlloc(gcThreads * sizeof(MarkWorker));
+
+    for (zint i = 0; i < gcThreads; i++) {
+        MarkWorker *one = &workers[i];
+        one->array = newDequeArray(DAT_MARK_DEQUE_MIN_SIZE);
+
+        if ((i != 0)
+            && (pthread_create(&one->thread, NULL, markHelperMain, one) != 0)) {
+            die("Failed to start gc thread.");
+        }
+    }
 }
 
 /**
- * Asserts that the value is valid, with thorough (and slow) checking.
+ * Parallel version of `drainMarkStack()`. This hands out the contents of
+ * the mark stack to the workers, and then marks in parallel until there is
+ * nothing left to mark.
  */
-static bool thoroughlyValidate(zvalue maybeValue, zmarkColor expectedColor) {
-    if (maybeValue == NULL) {
-        die("Invalid value: NULL");
+static zint drainMarkStackParallel(void) {
+    if (workers == NULL) {
+        initWorkers();
     }
 
-    if (!isAligned(maybeValue)) {
-        note("Invalid value (mis-aligned): %p", maybeValue);
-        return false;
+    for (zint i = 0; i < markStackSize; i++) {
+        dequePush(&workers[i % gcThreads], markStack[i]);
     }
 
-    if (!utilIsHeapAllocated(maybeValue)) {
-        note("Invalid value (not in heap): %p", maybeValue);
-        return false;
-    }
+    markStackSize = 0;
+    idleWorkers = 0;
 
-    if (maybeValue->mark != expectedColor) {
-        note("Invalid value (wrong color): %p", maybeValue);
-        return false;
+    // Wake up the helpers, do the main thread's share of the work, and
+    // then wait for the helpers to be done.
+
+    pthread_mutex_lock(&markLock);
+    activeHelpers = gcThreads - 1;
+    markGeneration++;
+    pthread_cond_broadcast(&markCond);
+    pthread_mutex_unlock(&markLock);
+
+    runMarkWorker(&workers[0]);
+
+    pthread_mutex_lock(&markLock);
+    while (activeHelpers != 0) {
+        pthread_cond_wait(&markCond, &markLock);
     }
+    pthread_mutex_unlock(&markLock);
 
-    if (!(isAligned(maybeValue->next) &&
-          isAligned(maybeValue->prev) &&
-          (maybeValue == maybeValue->next->prev) &&
-          (maybeValue == maybeValue->prev->next))) {
-        note("Invalid value (invalid links): %p", maybeValue);
-        return false;
+    // Tally up, and free any deque arrays that got replaced.
+
+    zint counter = 0;
+
+    for (zint i = 0; i < gcThreads; i++) {
+        MarkWorker *one = &workers[i];
+        DequeArray *prev = one->array->prev;
+
+        counter += one->markCount;
+        one->array->prev = NULL;
+
+        while (prev != NULL) {
+            DequeArray *next = prev->prev;
+            utilFree(prev);
+            prev = next;
+        }
     }
 
-    return true;
+    return counter;
 }
 
 /**
- * Sanity check the circular list with the given head.
+ * Marks the innards of everything on the mark stack, until the stack
+ * is empty. Returns the number of values processed.
  */
-static bool sanityCheckList(DatHeader *head, zmarkColor expectedColor) {
-    for (zvalue item = head->next; item != head; item = item->next) {
-        if (!thoroughlyValidate(item, expectedColor)) {
-            return false;
-        }
+static zint drainMarkStack(void) {
+    if (gcThreads > 1) {
+        return drainMarkStackParallel();
     }
 
-    return true;
+    zint counter = 0;
+
+    while (markStackSize != 0) {
+        markStackSize--;
+        callGcMark(markStack[markStackSize]);
+        counter++;
+    }
+
+    return counter;
 }
 
 /**
- * Sanity check the links and tables.
+ * Adds the given value to the remembered set, growing the set if necessary.
  */
-static void sanityCheck(bool force) {
-    if (!(force || DAT_MEMORY_PARANOIA)) {
-        return;
+static void addRemembered(zvalue value) {
+    value->remembered = true;
+    valueArrayPush(&remembered, &rememberedSize, &rememberedMax,
+        DAT_REMEMBERED_MIN_SIZE, value);
+}
+
+/**
+ * Removes the given value from the remembered set, in the sense of clearing
+ * its flag. (The caller is responsible for the set itself.) If the value
+ * is sealed, then it gets added to the rescan set, since what was stored
+ * into it could well be non-sealed.
+ */
+static void forgetRemembered(zvalue value) {
+    value->remembered = false;
+
+    if (!value->rescan && segmentOf(value)->sealed) {
+        value->rescan = true;
+        valueArrayPush(&rescan, &rescanSize, &rescanMax,
+            DAT_RESCAN_MIN_SIZE, value);
     }
+}
 
-    for (zint i = 0; i < immortalsSize; i++) {
-        if (!thoroughlyValidate(immortals[i], liveColor)) {
-            die("...at immortal #%lld", i);
+/**
+ * Empties the remembered set, without doing any marking.
+ */
+static void clearRemembered(void) {
+    for (zint i = 0; i < rememberedSize; i++) {
+        forgetRemembered(remembered[i]);
+    }
+
+    rememberedSize = 0;
+}
+
+/**
+ * Gets the initial `classStats` index to probe for the given class.
+ * Classes are often at the same offset within their segments, so this
+ * mixes the high bits of the address in with the low ones.
+ */
+static zint classStatsIndex(zvalue cls) {
+    uint64_t hash = (uintptr_t) cls;
+
+    hash ^= hash >> 32;
+    hash *= 0x9e3779b97f4a7c15;
+    hash ^= hash >> 29;
+
+    return hash & (classStatsMax - 1);
+}
+
+/**
+ * Replaces `classStats` with a new table of the given size, containing
+ * all the same (non-empty) entries.
+ */
+static void rehashClassStats(zint newMax) {
+    DatClassStats *oldStats = classStats;
+    zint oldMax = classStatsMax;
+
+    classStats = utilAlloc(newMax * sizeof(DatClassStats));
+    classStatsMax = newMax;
+
+    for (zint i = 0; i < oldMax; i++) {
+        DatClassStats *one = &oldStats[i];
+
+        if (one->cls != NULL) {
+            zint at = classStatsIndex(one->cls);
+
+            while (classStats[at].cls != NULL) {
+                at = (at + 1) & (newMax - 1);
+            }
+
+            classStats[at] = *one;
         }
     }
 
-    if (!sanityCheckList(&liveHead, liveColor)) {
-        die("...on live list.");
+    utilFree(oldStats);
+}
+
+/**
+ * Finds the allocation statistics entry for the given class, adding a new
+ * one if there isn't already one.
+ */
+static DatClassStats *findClassStats(zvalue cls) {
+    if (classStatsSize * 2 >= classStatsMax) {
+        rehashClassStats((classStatsMax == 0)
+            ? DAT_CLASS_STATS_MIN_SIZE
+            : classStatsMax * 2);
     }
 
-    if (!sanityCheckList(&doomedHead, liveColor ^ 1)) {
-        die("...on doomed list.");
+    zint at = classStatsIndex(cls);
+
+    for (;;) {
+        DatClassStats *one = &classStats[at];
+
+        if (one->cls == cls) {
+            return one;
+        } else if (one->cls == NULL) {
+            one->cls = cls;
+            classStatsSize++;
+            return one;
+        }
+
+        at = (at + 1) & (classStatsMax - 1);
     }
 }
 
 /**
- * Links the given value onto the end of the given list, removing it from its
- * previous list (if any).
+ * Removes the allocation statistics entries for classes that are about to
+ * be freed, folding them into `freedClassStats`. This must be called after
+ * marking and before sweeping.
  */
-static void enlist(DatHeader *head, zvalue value) {
-    if (value->next != NULL) {
-        zvalue next = value->next;
-        zvalue prev = value->prev;
-        next->prev = prev;
-        prev->next = next;
+static void pruneClassStats(void) {
+    bool any = false;
+
+    for (zint i = 0; i < classStatsMax; i++) {
+        DatClassStats *one = &classStats[i];
+
+        if ((one->cls != NULL) && !isMarked(one->cls)) {
+            freedClassStats.count += one->count;
+            freedClassStats.bytes += one->bytes;
+            *one = (DatClassStats) { NULL, 0, 0 };
+            classStatsSize--;
+            any = true;
+        }
     }
 
-    zvalue headPrev = head->prev;
-
-    value->prev = headPrev;
-    value->next = head;
-    headPrev->next = value;
-    head->prev = value;
+    if (any) {
+        // Removal can break up probe sequences, so rebuild the table.
+        rehashClassStats(classStatsMax);
+    }
 }
 
 /**
- * Main garbage collection function.
+ * Minor garbage collection function. This only collects the nursery. Nursery
+ * values that are found to be live get promoted to the old generation.
  */
-static void doGc(void) {
+static void doMinorGc(void) {
     zint counter;  // Used throughout.
 
-    if (SYM(gcMark) == NULL) {
-        die("`dat` module not yet initialized.");
+    // The root set consists of the stack and the remembered set. Immortals
+    // are already in the old generation (see `datImmortalize()`), and any
+    // references stored in them afterwards cause them to be remembered.
+    // All other old values are presumed to only refer to other old values.
+    // Old values are already marked, so marking only ever reaches nursery
+    // values.
+
+    counter = markFrameStack();
+
+    if (DAT_CHATTY_GC) {
+        note("GC: Marked %lld stack values.", counter);
     }
 
-    sanityCheck(false);
+    // Raw profiling samples refer to values which were on the stack when
+    // the samples were taken, and they need to stay alive until the
+    // samples get symbolized.
+    profileMark();
 
-    // Quick check: If there have been no allocations, then there's nothing
-    // to do.
+    // A pending tail call's arguments aren't on the frame stack until the
+    // call gets made.
+    callMark();
 
-    if (liveHead.next == &liveHead) {
-        return;
+    for (zint i = 0; i < rememberedSize; i++) {
+        zvalue one = remembered[i];
+        forgetRemembered(one);
+        callGcMark(one);
+    }
+
+    if (DAT_CHATTY_GC) {
+        note("GC: Scanned %lld remembered values.", rememberedSize);
+    }
+
+    rememberedSize = 0;
+
+    // Calls to `datMark()` just push values onto the mark stack and do not
+    // call through to mark their innards. Draining the stack does that
+    // marking, which can cause yet more values to be pushed.
+
+    counter = drainMarkStack();
+    pruneClassStats();
+    symbolPruneUnlisted();
+
+    // Free every nursery value that didn't get marked. Empty segments are
+    // kept around, since the nursery is about to fill them again.
+
+    zint freedCount = sweepHeap(false);
+    liveBytes = countBytes();
+
+    if (DAT_CHATTY_GC) {
+        liveCount -= freedCount;
+        note("GC: Promoted %lld values.", counter);
+        note("GC: Freed %lld dead values.", freedCount);
+        note("GC: %lld live values remain.", liveCount);
     }
+}
+
+/**
+ * Major garbage collection function. This collects the entire heap, both
+ * old generation and nursery.
+ */
+static void doMajorGc(void) {
+    zint counter;  // Used throughout.
 
-    // Start by dooming everything.
+    // Every value is about to get traced, so there's no need for the
+    // remembered set.
 
-    doomedHead = liveHead;
-    doomedHead.next->prev = &doomedHead;
-    doomedHead.prev->next = &doomedHead;
-    liveHead.next = &liveHead;
-    liveHead.prev = &liveHead;
+    clearRemembered();
 
-    liveColor = liveColor ^ 1;
+    // Start by unmarking everything (other than sealed values).
 
-    // The root set consists of immortals and the stack. Recursively mark
-    // those, which causes anything found to be alive to be linked into
-    // the live list.
+    clearMarks();
+
+    // The root set consists of immortals, the rescan set, and the stack.
+    // Sealed values are all still marked, so marking stops at them. The
+    // only way a sealed value can refer to a non-sealed one is if it has
+    // been written to, in which case it is in the rescan set.
 
     for (zint i = 0; i < immortalsSize; i++) {
         datMark(immortals[i]);
@@ -190,57 +1335,275 @@ static void doGc(void) {
         note("GC: Marked %lld immortals.", immortalsSize);
     }
 
+    for (zint i = 0; i < rescanSize; i++) {
+        callGcMark(rescan[i]);
+    }
+
+    if (DAT_CHATTY_GC) {
+        note("GC: Scanned %lld sealed values.", rescanSize);
+    }
+
     counter = markFrameStack();
 
     if (DAT_CHATTY_GC) {
         note("GC: Marked %lld stack values.", counter);
     }
 
-    // Calls to `datMark()` just place items on the live list but do not call
-    // through to mark their innards. The following loop walks down the live
-    // list doing that marking, which can cause yet more items to be enlisted.
-    // Since new items are added to the end of the list, there's nothing
-    // special to do to handle such new entries.
+    // Raw profiling samples refer to values which were on the stack when
+    // the samples were taken, and they need to stay alive until the
+    // samples get symbolized.
+    profileMark();
 
-    for (zvalue item = liveHead.next; item != &liveHead; item = item->next) {
-        callGcMark(item);
-    }
+    // A pending tail call's arguments aren't on the frame stack until the
+    // call gets made.
+    callMark();
 
-    // Free everything left on the doomed list.
+    // See comment in `doMinorGc()` about the mark stack.
 
-    sanityCheck(false);
+    drainMarkStack();
+    pruneClassStats();
+    symbolPruneUnlisted();
+
+    // Free everything that didn't get marked, and return empty segments to
+    // the OS.
+
+    counter = sweepHeap(true);
+    liveBytes = countBytes();
+
+    // Let the heap grow in proportion to what survived, before doing this
+    // again.
+
+    majorGcBytes = (liveBytes / 100) * heapGrowthPercent;
+    if (majorGcBytes < minHeapBytes) {
+        majorGcBytes = minHeapBytes;
+    }
 
     if (DAT_CHATTY_GC) {
-        counter = 0;
+        liveCount -= counter;
+        note("GC: Freed %lld dead values.", counter);
+        note("GC: %lld live values remain.", liveCount);
+        note("GC: Next major gc at %lld bytes.", majorGcBytes);
+    }
+}
+
+/**
+ * Records the statistics for a just-completed gc.
+ */
+static void noteGcCycle(bool major, zint pauseUsec) {
+    zint bucket = 0;
+    while ((bucket < (DAT_GC_PAUSE_BUCKETS - 1))
+        && (pauseUsec >= ((zint) 1 << bucket))) {
+        bucket++;
+    }
+
+    pauseHistogram[bucket]++;
+    totalPauseUsec += pauseUsec;
+
+    if (pauseUsec > maxPauseUsec) {
+        maxPauseUsec = pauseUsec;
+    }
+
+    if (major) {
+        majorGcCount++;
+    }
+
+    zint live = liveBytes + sealedBytes;
+
+    if (live > peakLiveBytes) {
+        peakLiveBytes = live;
+    }
+
+    gcHistory[gcCount % DAT_GC_HISTORY_SIZE] =
+        (DatGcCycle) { major, pauseUsec, live };
+}
+
+/**
+ * Comparison function for `DatClassStats`, for sorting in order of
+ * decreasing bytes.
+ */
+static int compareClassStats(const void *s1, const void *s2) {
+    const DatClassStats *stats1 = s1;
+    const DatClassStats *stats2 = s2;
+
+    if (stats1->bytes > stats2->bytes) {
+        return -1;
+    } else if (stats1->bytes < stats2->bytes) {
+        return 1;
+    } else {
+        return 0;
     }
+}
 
-    for (zvalue item = doomedHead.next; item != &doomedHead; /*next*/) {
-        if (item->mark == liveColor) {
-            die("Live item on doomed list!");
+/**
+ * Prints a report of all the allocation and gc statistics. This is set up
+ * to run at exit when the environment variable `SAMEX_GC_STATS` is set.
+ * It is careful not to allocate any values, so that it is safe to call
+ * no matter what state the system is in.
+ */
+static void printGcStats(void) {
+    DatGcStats stats;
+    datGetGcStats(&stats);
+
+    note("GC stats:");
+    note("  Allocated:     %lld values, %lld bytes",
+        stats.allocCount, stats.allocBytes);
+    note("  Collections:   %lld (%lld major)",
+        stats.gcCount, stats.majorGcCount);
+    note("  Pause time:    %.3f msec total, %.3f msec max",
+        stats.totalPauseUsec / 1000.0, stats.maxPauseUsec / 1000.0);
+    note("  Live bytes:    %lld now, %lld peak",
+        stats.liveBytes, stats.peakLiveBytes);
+    note("  Frame stack:   %lld values peak",
+        stats.frameStackHighWater);
+
+    note("  Pause histogram:");
+    for (zint i = 0; i < DAT_GC_PAUSE_BUCKETS; i++) {
+        zint count = stats.pauseHistogram[i];
+
+        if (count == 0) {
+            continue;
+        } else if (i == (DAT_GC_PAUSE_BUCKETS - 1)) {
+            note("    >= %9lld usec: %lld", (zint) 1 << (i - 1), count);
+        } else {
+            note("    < %10lld usec: %lld", (zint) 1 << i, count);
         }
+    }
+
+    zint size = datGetClassStats(0, NULL);
+    DatClassStats *classes = utilAlloc(size * sizeof(DatClassStats));
+
+    datGetClassStats(size, classes);
+    qsort(classes, size, sizeof(DatClassStats), compareClassStats);
+
+    note("  Allocations by class:");
+    for (zint i = 0; i < size; i++) {
+        DatClassStats *one = &classes[i];
+        zvalue name = (one->cls == NULL)
+            ? NULL
+            : classNameUnchecked(one->cls);
+        char *nameStr = (name == NULL)
+            ? NULL
+            : utf8DupFromZstring(zstringFromSymbol(name));
+        const char *label = (one->cls == NULL)
+            ? "(freed classes)"
+            : ((nameStr == NULL) ? "(unnamed)" : nameStr);
+
+        note("    %12lld bytes %10lld values  %s",
+            one->bytes, one->count, label);
+        utilFree(nameStr);
+    }
+
+    utilFree(classes);
+}
 
-        // Need to grab `item->next` before freeing the item.
-        zvalue next = item->next;
+/**
+ * Gets a gc tuning parameter from the environment variable with the given
+ * name, as a positive int. If `allowSuffix` is `true`, the value may have a
+ * `k`, `m`, or `g` suffix (for kibi-, mebi-, or gibibytes). Returns
+ * `defaultValue` if the variable isn't set.
+ */
+static zint envParam(const char *name, zint defaultValue, bool allowSuffix) {
+    const char *str = getenv(name);
 
-        // Prevent this from being mistaken for a live value.
-        item->next = item->prev = NULL;
-        item->cls = NULL;
+    if ((str == NULL) || (*str == '\0')) {
+        return defaultValue;
+    }
 
-        utilFree(item);
-        item = next;
+    char *end;
+    zint result = strtoll(str, &end, 10);
 
-        if (DAT_CHATTY_GC) {
-            counter++;
-            liveCount--;
+    if (allowSuffix) {
+        switch (*end) {
+            case 'k': case 'K': { result *= 1024;               end++; break; }
+            case 'm': case 'M': { result *= 1024 * 1024;        end++; break; }
+            case 'g': case 'G': { result *= 1024 * 1024 * 1024; end++; break; }
         }
     }
 
-    doomedHead.next = &doomedHead;
-    doomedHead.prev = &doomedHead;
+    if ((end == str) || (*end != '\0') || (result <= 0)) {
+        die("Invalid value for %s: %s", name, str);
+    }
+
+    return result;
+}
+
+/**
+ * Sets up the gc tuning parameters, from the environment (see the
+ * `README.md` for details) or using the defaults.
+ */
+static void initGcParams(void) {
+    nurseryBytes =
+        envParam("SAMEX_GC_NURSERY", DAT_DEFAULT_NURSERY_BYTES, true);
+    minHeapBytes =
+        envParam("SAMEX_GC_MIN_HEAP", DAT_DEFAULT_MIN_HEAP_BYTES, true);
+    heapGrowthPercent =
+        envParam("SAMEX_GC_HEAP_GROWTH", DAT_DEFAULT_HEAP_GROWTH, false);
+
+    if (heapGrowthPercent <= 100) {
+        die("Invalid value for SAMEX_GC_HEAP_GROWTH: %lld (must be over 100)",
+            heapGrowthPercent);
+    }
+
+    // By default, use as many threads as there are processors, up to a
+    // limit.
+    zint defaultThreads = sysconf(_SC_NPROCESSORS_ONLN);
+    if (defaultThreads < 1) {
+        defaultThreads = 1;
+    } else if (defaultThreads > DAT_DEFAULT_MAX_GC_THREADS) {
+        defaultThreads = DAT_DEFAULT_MAX_GC_THREADS;
+    }
+
+    gcThreads = envParam("SAMEX_GC_THREADS", defaultThreads, false);
+
+    majorGcBytes = minHeapBytes;
+
+    const char *statsStr = getenv("SAMEX_GC_STATS");
+    if ((statsStr != NULL) && (*statsStr != '\0')) {
+        atexit(printGcStats);
+    }
+}
+
+/**
+ * Main garbage collection function. This performs either a minor or a
+ * major gc, as requested.
+ */
+static void doGc(bool major) {
+    if (SYM(gcMark) == NULL) {
+        die("`dat` module not yet initialized.");
+    }
+
+    allocatedBytes = 0;
+    profileGcStart();
+    sanityCheck(false);
+
+    // The method cache doesn't keep its classes alive, so it could end up
+    // referring to freed ones.
+    classClearMethodCache();
+
+    struct timespec startTime;
+    clock_gettime(CLOCK_MONOTONIC, &startTime);
+
+    if (DAT_CHATTY_GC) {
+        note("GC: Cycle #%lld (%s, %lld thread%s).", gcCount,
+            major ? "major" : "minor", gcThreads, (gcThreads == 1) ? "" : "s");
+    }
+
+    if (major) {
+        doMajorGc();
+    } else {
+        doMinorGc();
+    }
+
+    struct timespec endTime;
+    clock_gettime(CLOCK_MONOTONIC, &endTime);
+
+    zint pauseUsec = (endTime.tv_sec - startTime.tv_sec) * 1000000
+        + (endTime.tv_nsec - startTime.tv_nsec) / 1000;
+    noteGcCycle(major, pauseUsec);
 
     if (DAT_CHATTY_GC) {
-        note("GC: Freed %lld dead values.", counter);
-        note("GC: %lld live values remain.", liveCount);
+        note("GC: %g msec this cycle. %g sec overall.",
+            pauseUsec / 1000.0, totalPauseUsec / 1000000.0);
     }
 
     // Occasional sanity check.
@@ -249,6 +1612,18 @@ static void doGc(void) {
     if (DAT_MEMORY_PARANOIA || ((gcCount & 0x3f) == 0)) {
         sanityCheck(true);
     }
+
+    profileGcEnd();
+}
+
+
+//
+// Module Definitions
+//
+
+// Documented in header.
+bool gcIsMarked(zvalue value) {
+    return isMarked(value);
 }
 
 
@@ -264,18 +1639,34 @@ zvalue datAllocValue(zvalue cls, zint extraBytes) {
         }
     }
 
-    if (allocationCount >= DAT_ALLOCATIONS_PER_GC) {
-        datGc();
+    if (allocatedBytes >= nurseryBytes) {
+        if (nurseryBytes == 0) {
+            // This is the very first allocation.
+            initGcParams();
+        } else if (SYM(gcMark) != NULL) {
+            // Note: Until the `dat` module is initialized, the heap just
+            // grows.
+            doGc(liveBytes >= majorGcBytes);
+        }
     } else {
         sanityCheck(false);
     }
 
-    zvalue result = utilAlloc(sizeof(DatHeader) + extraBytes);
-    result->mark  = liveColor;
-    result->cls   = cls;
+    zint size = sizeof(DatHeader) + extraBytes;
+    zvalue result = allocCell(size);
+    result->cls = cls;
+
+    allocCount++;
+    allocBytes += size;
+
+    if (cls != NULL) {
+        // Note: `cls` is only ever `NULL` during bootstrap, when allocating
+        // the class `Metaclass`.
+        DatClassStats *stats = findClassStats(cls);
+        stats->count++;
+        stats->bytes += size;
+    }
 
-    allocationCount++;
-    enlist(&liveHead, result);
     datFrameAdd(result);
     sanityCheck(false);
 
@@ -290,10 +1681,12 @@ zvalue datAllocValue(zvalue cls, zint extraBytes) {
 void assertValid(zvalue value) {
     if (value == NULL) {
         die("Null value.");
+    } else if (datIsImmediateInt(value)) {
+        return;
     }
 
-    if (value->mark != liveColor) {
-        die("Invalid value (wrong color): %p", value);
+    if (!isAllocated(value)) {
+        die("Invalid value (not allocated): %p", value);
     }
 
     if (value->cls == NULL) {
@@ -310,47 +1703,148 @@ void assertValidOrNull(zvalue value) {
 
 // Documented in header.
 void datGc(void) {
-    allocationCount = 0;
+    doGc(true);
+}
 
-    if (DAT_CHATTY_GC) {
-        static double totalSec = 0;
-        clock_t startTime = clock();
+// Documented in header.
+zint datGetClassStats(zint max, DatClassStats *result) {
+    zint at = 0;
+
+    for (zint i = 0; i < classStatsMax; i++) {
+        if (classStats[i].cls != NULL) {
+            if (at < max) {
+                result[at] = classStats[i];
+            }
+            at++;
+        }
+    }
 
-        note("GC: Cycle #%lld.", gcCount);
-        doGc();
+    if (freedClassStats.count != 0) {
+        if (at < max) {
+            result[at] = freedClassStats;
+        }
+        at++;
+    }
 
-        double elapsedSec = (double) (clock() - startTime) / CLOCKS_PER_SEC;
-        totalSec += elapsedSec;
-        note("GC: %g msec this cycle. %g sec overall.",
-            elapsedSec * 1000, totalSec);
-    } else {
-        doGc();
+    return at;
+}
+
+// Documented in header.
+void datGetGcStats(DatGcStats *result) {
+    result->allocCount = allocCount;
+    result->allocBytes = allocBytes;
+    result->gcCount = gcCount;
+    result->majorGcCount = majorGcCount;
+    result->totalPauseUsec = totalPauseUsec;
+    result->maxPauseUsec = maxPauseUsec;
+    utilCpy(zint, result->pauseHistogram, pauseHistogram,
+        DAT_GC_PAUSE_BUCKETS);
+    result->liveBytes = liveBytes + sealedBytes;
+    result->peakLiveBytes = peakLiveBytes;
+    result->frameStackHighWater = frameStackHighWater();
+
+    zint count = (gcCount < DAT_GC_HISTORY_SIZE)
+        ? gcCount
+        : DAT_GC_HISTORY_SIZE;
+
+    result->recentCount = count;
+    for (zint i = 0; i < count; i++) {
+        result->recentCycles[i] =
+            gcHistory[(gcCount - count + i) % DAT_GC_HISTORY_SIZE];
     }
 }
 
 // Documented in header.
 zvalue datImmortalize(zvalue value) {
-    if (immortalsSize == DAT_MAX_IMMORTALS) {
-        die("Too many immortal values!");
+    assertValid(value);
+
+    if (datIsImmediateInt(value)) {
+        // Nothing to do; immediate ints aren't ever collected.
+        return value;
     }
 
-    assertValid(value);
+    valueArrayPush(&immortals, &immortalsSize, &immortalsMax,
+        DAT_IMMORTALS_MIN_SIZE, value);
+
+    // Immortals go straight into the old generation. The value gets
+    // remembered, since it may well refer to nursery values.
+    if (!isMarked(value)) {
+        Segment *segment = segmentOf(value);
+        bitSet(segment->marks, bitIndexOf(segment, value));
+    }
 
-    immortals[immortalsSize] = value;
-    immortalsSize++;
+    datWriteBarrier(value);
     return value;
 }
 
 // Documented in header.
 void datMark(zvalue value) {
-    if (value == NULL) {
+    if ((value == NULL) || datIsImmediateInt(value)) {
         return;
     }
 
     // Mark the value, and iterate to mark its class (and then metaclass,
     // etc.). The loop is needed since classes are not all immortal.
-    for (/*value*/; value->mark != liveColor; value = value->cls) {
-        value->mark = liveColor;
-        enlist(&liveHead, value);
+
+    MarkWorker *worker = currentWorker;
+
+    if (worker != NULL) {
+        // This is a parallel mark.
+        for (/*value*/; claimMark(value); value = value->cls) {
+            dequePush(worker, value);
+        }
+        return;
+    }
+
+    for (/*value*/; !isMarked(value); value = value->cls) {
+        Segment *segment = segmentOf(value);
+        bitSet(segment->marks, bitIndexOf(segment, value));
+        markStackPush(value);
+    }
+}
+
+// Documented in header.
+void datSealHeap(void) {
+    // Start with a major gc, so that only live values get sealed, and so
+    // that each of those has its mark bit set.
+    doGc(true);
+
+    // Move every segment to the sealed list.
+
+    for (zint i = -1; i < SIZE_CLASS_COUNT; i++) {
+        Segment **head = (i < 0) ? &largeSegments : &sizeClasses[i].segments;
+
+        while (*head != NULL) {
+            Segment *segment = *head;
+            *head = segment->next;
+            segment->sealed = true;
+            segment->next = sealedSegments;
+            sealedSegments = segment;
+        }
+
+        if (i >= 0) {
+            sizeClasses[i].refillNext = NULL;
+            sizeClasses[i].freeList = NULL;
+        }
+    }
+
+    // Immortals are all sealed now, and so don't need to be marked anymore.
+    immortalsSize = 0;
+
+    // Sealed values don't count as part of the heap, for the purpose of
+    // deciding when to do a major gc.
+    sealedBytes += liveBytes;
+    liveBytes = 0;
+    majorGcBytes = minHeapBytes;
+
+    if (DAT_CHATTY_GC) {
+        note("GC: Sealed the heap.");
+    }
+}
+
+// Documented in header.
+void datWriteBarrier(zvalue value) {
+    if (!value->remembered && isMarked(value)) {
+        addRemembered(value);
     }
 }
@@ -24,15 +24,36 @@
 //
 
 /**
- * Struct used to hold the salient info for generating a stack trace.
+ * Pending tail call, as set up by `methTailCall()`. Only one tail call
+ * can be pending at a time, since it gets made as soon as the function
+ * that set it up has returned, before any other call can be made.
  */
-typedef struct {
-    /** Target being called. */
+static struct {
+    /** Whether there is a pending call. */
+    bool pending;
+
+    /** Target of the call. */
     zvalue target;
 
-    /** Name of method being called. */
+    /** Name of the method to call. */
     zvalue name;
-} StackTraceEntry;
+
+    /** Whether the call must return a value (not void). */
+    bool mustBeValue;
+
+    /** Number of arguments. */
+    zint argCount;
+
+    /** Arguments to the call. */
+    zvalue args[DAT_MAX_TAIL_CALL_ARGS];
+} tailCall;
+
+/**
+ * Special result value which indicates that there is a pending tail call.
+ * This is the address of the pending call info, and it never escapes this
+ * file.
+ */
+#define TAIL_CALL ((zvalue) &tailCall)
 
 /**
  * Returns a `dup()`ed string representing `value`. The result is the chars
@@ -51,11 +72,167 @@ static char *ensureString(zvalue value) {
     return utf8DupFromString(value);
 }
 
+// Declared here, as it is mutually recursive with `callBoundMethod()`.
+static zvalue methCall0(zvalue target, zint nameIndex, zarray args);
+
+/**
+ * Dies with an "unbound method" error.
+ */
+static void unboundMethod(zvalue cls, zint nameIndex) {
+    zvalue nameStr = cm_castFrom(CLS_String, symbolFromIndex(nameIndex));
+    die("Unbound method: %s.%s", cm_debugString(cls),
+        cm_debugString(nameStr));
+}
+
+/**
+ * Helper for `methCall0` and `methCallCached0`, which calls `function` as
+ * the method bound for `target`, with the given `args`.
+ */
+static zvalue callBoundMethod(zvalue function, zvalue target, zarray args) {
+    if (classOf(function) == CLS_Builtin) {
+        // Builtins can take the target separately from the other arguments,
+        // which (usually) avoids copying them.
+        return builtinCallMethod(function, target, args);
+    }
+
+    // Prepend `target` as a new first argument for a call to `function`.
+    zint newSize = args.size + 1;
+    zvalue newArgs[newSize];
+    newArgs[0] = target;
+    utilCpy(zvalue, &newArgs[1], args.elems, args.size);
+
+    // Invoke `function.call(target, args*)`.
+    return methCall0(function, SYMIDX(call), (zarray) {newSize, newArgs});
+}
+
 /**
- * This is the function that handles emitting a context string for a method
- * call, when dumping the stack.
+ * Helper for `methCall`, which does most of the work but skips argument
+ * validation, reference frame, and stack trace setup.
  */
-static char *callReporter(void *state) {
+static zvalue methCall0(zvalue target, zint nameIndex, zarray args) {
+    zvalue cls = classOf(target);
+
+    if ((cls == CLS_Builtin) && (nameIndex == SYMIDX(call))) {
+        // We are doing an invocation of `Builtin.call()`. Handle this as a
+        // special case, in order to break the recursion.
+        return builtinCall(target, args);
+    }
+
+    zvalue function = classFindMethodUnchecked(cls, nameIndex);
+
+    if (function == NULL) {
+        unboundMethod(cls, nameIndex);
+    }
+
+    return callBoundMethod(function, target, args);
+}
+
+/**
+ * Helper for `methCallCached`, which is to it as `methCall0` is to
+ * `methCall`.
+ */
+static zvalue methCallCached0(zcallCache *cache, zvalue target, zvalue name,
+        zarray args) {
+    zvalue cls = classOf(target);
+
+    if ((cls == CLS_Builtin) && (name == SYM(call))) {
+        // See comment in `methCall0()`.
+        return builtinCall(target, args);
+    }
+
+    zvalue function = classFindMethodCached(cache, cls, name);
+
+    if (function == NULL) {
+        unboundMethod(cls, symbolIndex(name));
+    }
+
+    return callBoundMethod(function, target, args);
+}
+
+/**
+ * Points the given giblet at a new stack trace entry. The entry must be
+ * fully set up before this is called. This is a single store, so that the
+ * profiling signal handler never sees a half-updated entry.
+ */
+static void publishEntry(UtilStackGiblet *giblet, StackTraceEntry *ste) {
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);
+    giblet->state = ste;
+}
+
+/**
+ * Helper for `methCall` and `methCallCached`, which makes the pending tail
+ * call, along with any tail calls that it in turn sets up. `giblet` is the
+ * caller's stack giblet, which gets updated to reflect each call as it is
+ * made, and `save` is the caller's frame stack pointer.
+ */
+static zvalue runTailCalls(UtilStackGiblet *giblet, zstackPointer save) {
+    StackTraceEntry *origSte = giblet->state;
+    bool mustBeValue = false;
+    zvalue result;
+
+    // Each call gets a fresh entry, alternating between these two, so that
+    // an entry is never modified while it is the one being pointed at.
+    StackTraceEntry entries[2];
+    zint which = 0;
+
+    do {
+        zint argCount = tailCall.argCount;
+        zvalue args[argCount];
+        StackTraceEntry *ste = &entries[which];
+
+        ste->target = tailCall.target;
+        ste->name = tailCall.name;
+        mustBeValue |= tailCall.mustBeValue;
+        utilCpy(zvalue, args, tailCall.args, argCount);
+        tailCall.pending = false;
+        publishEntry(giblet, ste);
+        which ^= 1;
+
+        // Drop the references made by the previous call, other than the
+        // ones needed to make the next one.
+        datFrameReturn(save, ste->target);
+        datFrameAdd(ste->name);
+        for (zint i = 0; i < argCount; i++) {
+            datFrameAdd(args[i]);
+        }
+
+        result = methCall0(ste->target, symbolIndex(ste->name),
+            (zarray) {argCount, args});
+    } while (result == TAIL_CALL);
+
+    // Point the giblet back at the caller's own entry, since `entries` is
+    // about to go away. It's updated first, to match the last call made.
+    *origSte = entries[which ^ 1];
+    publishEntry(giblet, origSte);
+
+    if (mustBeValue && (result == NULL)) {
+        datNonVoidError();
+    }
+
+    return result;
+}
+
+
+//
+// Module Definitions
+//
+
+// Documented in header.
+void callMark(void) {
+    if (!tailCall.pending) {
+        return;
+    }
+
+    datMark(tailCall.target);
+    datMark(tailCall.name);
+
+    for (zint i = 0; i < tailCall.argCount; i++) {
+        datMark(tailCall.args[i]);
+    }
+}
+
+// Documented in header.
+char *callReporter(void *state) {
     StackTraceEntry *ste = state;
     char *classStr =
         ensureString(METH_CALL(classOf(ste->target), debugSymbol));
@@ -86,37 +263,6 @@ static char *callReporter(void *state) {
     return result;
 }
 
-/**
- * Helper for `methCall`, which does most of the work but skips argument
- * validation, reference frame, and stack trace setup.
- */
-static zvalue methCall0(zvalue target, zint nameIndex, zarray args) {
-    zvalue cls = classOf(target);
-
-    if ((cls == CLS_Builtin) && (nameIndex == SYMIDX(call))) {
-        // We are doing an invocation of `Builtin.call()`. Handle this as a
-        // special case, in order to break the recursion.
-        return builtinCall(target, args);
-    }
-
-    zvalue function = classFindMethodUnchecked(cls, nameIndex);
-
-    if (function == NULL) {
-        zvalue nameStr = cm_castFrom(CLS_String, symbolFromIndex(nameIndex));
-        die("Unbound method: %s.%s", cm_debugString(cls),
-            cm_debugString(nameStr));
-    }
-
-    // Prepend `target` as a new first argument for a call to `function`.
-    zint newSize = args.size + 1;
-    zvalue newArgs[newSize];
-    newArgs[0] = target;
-    utilCpy(zvalue, &newArgs[1], args.elems, args.size);
-
-    // Invoke `function.call(target, args*)`.
-    return methCall0(function, SYMIDX(call), (zarray) {newSize, newArgs});
-}
-
 
 //
 // Exported Definitions
@@ -133,17 +279,79 @@ zvalue methApply(zvalue target, zvalue name, zvalue args) {
 zvalue methCall(zvalue target, zvalue name, zarray args) {
     zint nameIndex = symbolIndex(name);
 
+    if (tailCall.pending) {
+        die("Call made with a tail call pending.");
+    }
+
+    if (profilePendingCount != 0) {
+        profileDrain();
+    }
+
     StackTraceEntry ste = {.target = target, .name = name};
     UTIL_TRACE_START(callReporter, &ste);
 
     zstackPointer save = datFrameStart();
     zvalue result = methCall0(target, nameIndex, args);
+
+    if (result == TAIL_CALL) {
+        result = runTailCalls(&stackGiblet, save);
+    }
+
     datFrameReturn(save, result);
 
     UTIL_TRACE_END();
     return result;
 }
 
+// Documented in header.
+zvalue methCallCached(zcallCache *cache, zvalue target, zvalue name,
+        zarray args) {
+    if (tailCall.pending) {
+        die("Call made with a tail call pending.");
+    }
+
+    if (profilePendingCount != 0) {
+        profileDrain();
+    }
+
+    StackTraceEntry ste = {.target = target, .name = name};
+    UTIL_TRACE_START(callReporter, &ste);
+
+    zstackPointer save = datFrameStart();
+    zvalue result = methCallCached0(cache, target, name, args);
+
+    if (result == TAIL_CALL) {
+        result = runTailCalls(&stackGiblet, save);
+    }
+
+    datFrameReturn(save, result);
+
+    UTIL_TRACE_END();
+    return result;
+}
+
+// Documented in header.
+zvalue methTailCall(zvalue target, zvalue name, zarray args,
+        bool mustBeValue) {
+    if (args.size > DAT_MAX_TAIL_CALL_ARGS) {
+        zvalue result = methCall(target, name, args);
+        return mustBeValue ? datNonVoid(result) : result;
+    }
+
+    if (tailCall.pending) {
+        die("Tail call made with another one already pending.");
+    }
+
+    tailCall.pending = true;
+    tailCall.target = target;
+    tailCall.name = name;
+    tailCall.mustBeValue = mustBeValue;
+    tailCall.argCount = args.size;
+    utilCpy(zvalue, tailCall.args, args.elems, args.size);
+
+    return TAIL_CALL;
+}
+
 // Documented in header.
 zvalue mustNotYield(zvalue value) {
     die("Improper yield from `noYield` expression.");
@@ -37,6 +37,19 @@ void datFrameError(const char *msg) {
 // Module Definitions
 //
 
+zint frameStackHighWater(void) {
+    // Slots aren't cleared when frames are returned from, and `NULL` is
+    // never stored, so everything up through the last non-`NULL` slot has
+    // been in use at some point.
+    for (zint i = DAT_MAX_STACK; i > 0; i--) {
+        if (theStack[i - 1] != NULL) {
+            return i;
+        }
+    }
+
+    return 0;
+}
+
 zint markFrameStack(void) {
     zint stackSize = frameStackTop - frameStackBase;
 
@@ -9,25 +9,123 @@
 #ifndef _IMPL_H_
 #define _IMPL_H_
 
+#include <signal.h>
+
 #include "dat.h"
 #include "util.h"
 
 
 enum {
-    /** Number of allocations between each forced gc. */
-    DAT_ALLOCATIONS_PER_GC = 500000,
-
     /** Whether to spew to the console during gc. */
     DAT_CHATTY_GC = false,
 
+    /**
+     * Number of ancestors kept in each class's display (see
+     * `hasAncestorUnchecked()` in `Class.c`). Subclass checks against
+     * classes deeper than this have to walk the superclass chain.
+     */
+    DAT_CLASS_DISPLAY_SIZE = 16,
+
+    /**
+     * Initial size of the per-class allocation statistics table. Must be a
+     * power of two.
+     */
+    DAT_CLASS_STATS_MIN_SIZE = 256,
+
     /** Whether to be paranoid about values in collections / records. */
     DAT_CONSTRUCTION_PARANOIA = false,
 
+    /**
+     * Default maximum number of threads to use for marking during gc. The
+     * default is the number of processors, up to this limit. Overridden by
+     * the environment variable `SAMEX_GC_THREADS`.
+     */
+    DAT_DEFAULT_MAX_GC_THREADS = 8,
+
+    /**
+     * Default percentage of the live heap size (after a major gc) that the
+     * heap may grow to before the next major gc. Overridden by the
+     * environment variable `SAMEX_GC_HEAP_GROWTH`.
+     */
+    DAT_DEFAULT_HEAP_GROWTH = 200,
+
+    /**
+     * Default minimum heap size in bytes at which a major (full-heap) gc
+     * is done. Overridden by the environment variable `SAMEX_GC_MIN_HEAP`.
+     */
+    DAT_DEFAULT_MIN_HEAP_BYTES = 64 * 1024 * 1024,
+
+    /**
+     * Default number of bytes to allocate between each gc. Overridden by the
+     * environment variable `SAMEX_GC_NURSERY`.
+     */
+    DAT_DEFAULT_NURSERY_BYTES = 16 * 1024 * 1024,
+
+    /**
+     * Size in bytes of a heap granule. Cell sizes are multiples of this, and
+     * the heap bitmaps have one bit per granule.
+     */
+    DAT_GRANULE_SIZE = 8,
+
+    /** Initial size of the array of immortal values. */
+    DAT_IMMORTALS_MIN_SIZE = 1000,
+
+    /** Initial size of each parallel gc thread's mark deque. */
+    DAT_MARK_DEQUE_MIN_SIZE = 1024,
+
+    /** Initial size of the gc mark stack. */
+    DAT_MARK_STACK_MIN_SIZE = 10000,
+
+    /** Interval between profiling samples, in microseconds of CPU time. */
+    DAT_PROFILE_INTERVAL_USEC = 1000,
+
+    /**
+     * Maximum number of method calls recorded per profiling sample. Calls
+     * beyond this (the outermost ones) are left out.
+     */
+    DAT_PROFILE_MAX_DEPTH = 200,
+
+    /** Maximum number of raw profiling samples waiting to be symbolized. */
+    DAT_PROFILE_PENDING_SIZE = 16,
+
+    /**
+     * Initial size of the table of folded stacks, when profiling. Must be
+     * a power of two.
+     */
+    DAT_PROFILE_TABLE_MIN_SIZE = 1024,
+
+    /**
+     * Largest cell size (in bytes) that gets allocated out of a shared
+     * segment. Larger values each get a segment of their own.
+     */
+    DAT_MAX_CELL_SIZE = 16384,
+
     /** Largest code point to keep a cached single-character string for. */
     DAT_MAX_CACHED_CHAR = 127,
 
-    /** Maximum number of immortal values allowed. */
-    DAT_MAX_IMMORTALS = 10000,
+    /**
+     * Maximum size of a flat list produced by concatenation or by slicing
+     * a tree list. Larger results are trees, whose leaves are flat lists
+     * (see `List.c`).
+     */
+    DAT_MAX_FLAT_LIST_SIZE = 32,
+
+    /** Maximum number of children of an interior node of a tree list. */
+    DAT_MAX_LIST_NODE_CHILDREN = 32,
+
+    /**
+     * Maximum height of a tree list. Every interior node has at least two
+     * children, so a tree this tall would have more elements than a
+     * `zint` can count.
+     */
+    DAT_MAX_LIST_TREE_HEIGHT = 64,
+
+    /**
+     * Maximum size in characters of a string produced by `cat` as a flat
+     * string. Larger results are ropes, whose leaves are (generally) no
+     * larger than this (see `String.c`).
+     */
+    DAT_MAX_ROPE_LEAF_SIZE = 256,
 
     /** Maximum number of references on the stack. */
     DAT_MAX_STACK = 100000,
@@ -41,14 +139,32 @@ enum {
     /** Maximum size in characters of a symbol name. */
     DAT_MAX_SYMBOL_SIZE = 80,
 
-    /** Whether to be paranoid about corruption checks. */
-    DAT_MEMORY_PARANOIA = false,
+    /**
+     * Maximum number of arguments to a tail call (see `methTailCall()`).
+     * Calls with more arguments get made as regular calls.
+     */
+    DAT_MAX_TAIL_CALL_ARGS = 32,
+
+    /**
+     * Number of entries in the method cache (see
+     * `classFindMethodUnchecked()`). Must be a power of two.
+     */
+    DAT_METHOD_CACHE_SIZE = 4096,
 
-    /** Maximum (highest value) small int constant to keep. */
-    DAT_SMALL_INT_MAX = 700,
+    /** Initial size of the remembered set (see `datWriteBarrier()`). */
+    DAT_REMEMBERED_MIN_SIZE = 1000,
+
+    /** Initial size of the rescan set (see `datSealHeap()`). */
+    DAT_RESCAN_MIN_SIZE = 1000,
+
+    /**
+     * Size in bytes of a heap segment. Segments are aligned to this size,
+     * which is how a value's segment is found.
+     */
+    DAT_SEGMENT_SIZE = 256 * 1024,
 
-    /** Minumum (lowest value) small int constant to keep. */
-    DAT_SMALL_INT_MIN = -300,
+    /** Whether to be paranoid about corruption checks. */
+    DAT_MEMORY_PARANOIA = false,
 
     /**
      * Maximum number of probes allowed before using a larger symbol
@@ -56,6 +172,12 @@ enum {
      */
     DAT_SYMTAB_MAX_PROBES = 4,
 
+    /**
+     * Initial size of the arrays used to keep track of symbols, and of the
+     * table of interned symbols. Must be a power of two.
+     */
+    DAT_SYMBOLS_MIN_SIZE = 1024,
+
     /** Minimum size of a symbol table backing array. */
     DAT_SYMTAB_MIN_SIZE = 10,
 
@@ -66,42 +188,45 @@ enum {
     DAT_VALUE_ALIGNMENT = sizeof(zint)
 };
 
-/**
- * "Colors" used for gc marking. This is used instead of a boolean so that
- * we can flip the sense of marked-vs-not without actually having to flip a
- * bunch of bits in live objects.
- */
-typedef enum {
-    MARK_AZURE,
-    MARK_MAUVE
-} zmarkColor;
-
 /**
  * Common fields across all values. Used as a header for other types.
  *
  * **Note:** This must match the definition of `DatHeaderExposed` in `dat.h`.
  */
 typedef struct DatHeader {
-    /**
-     * Forward circular link. Every value is linked into a circularly
-     * linked list, which identifies its current fate / classification.
-     */
-    zvalue next;
-
-    /** Backward circular link. */
-    zvalue prev;
-
     /** Class of the value. This is always a `Class` instance. */
     zvalue cls;
 
-    /** Mark bit (used during GC). */
-    zmarkColor mark : 1;
+    /** Whether the value is in the remembered set. */
+    bool remembered : 1;
+
+    /** Whether the value is sealed and is in the rescan set. */
+    bool rescan : 1;
 
     /** Class-specific data goes here. */
     void *payload[/*flexible*/];
 } DatHeader;
 
 
+/**
+ * Struct used to hold the salient info for generating a stack trace.
+ */
+typedef struct {
+    /** Target being called. */
+    zvalue target;
+
+    /** Name of method being called. */
+    zvalue name;
+} StackTraceEntry;
+
+/**
+ * Number of raw profiling samples waiting to be symbolized. This is
+ * checked on every method call, which is when they get symbolized (see
+ * `profileDrain()`).
+ */
+extern volatile sig_atomic_t profilePendingCount;
+
+
 /**
  * Implementation of method `Builtin.call()`. This is used in the code
  * for `methCall()` to avoid infinite recursion. **Note:** Assumes that
@@ -109,6 +234,38 @@ typedef struct DatHeader {
  */
 zvalue builtinCall(zvalue function, zarray args);
 
+/**
+ * Calls the given builtin as a method, with the given target and (other)
+ * arguments. This is equivalent to calling `builtinCall()` with `ths`
+ * prepended to `args`, except that if the builtin has a method entry
+ * point (see `makeBuiltinMethod()`), then the arguments don't need to get
+ * copied. **Note:** Assumes that `function` is in fact an instance of
+ * `Builtin`.
+ */
+zvalue builtinCallMethod(zvalue function, zvalue ths, zarray args);
+
+/**
+ * Returns whether the given builtin has been declared thread-safe (see
+ * `builtinSetThreadSafe()`). **Note:** Assumes that `builtin` is in fact
+ * an instance of `Builtin`.
+ */
+bool builtinIsThreadSafe(zvalue builtin);
+
+/**
+ * Declares the given builtin to be safe to call from multiple threads
+ * at once. This is only used for `gcMark` methods, via
+ * `classSetThreadSafeGcMark()`. **Note:** Assumes that `builtin` is in fact
+ * an instance of `Builtin`.
+ */
+void builtinSetThreadSafe(zvalue builtin);
+
+/**
+ * Returns whether values of the given class can have their `gcMark` method
+ * called from multiple threads at once. This is `true` for classes without
+ * a `gcMark` method. See `classSetThreadSafeGcMark()`.
+ */
+bool classHasThreadSafeGcMark(zvalue cls);
+
 /**
  * Short-circuit to call the `.gcMark()` method on `value`, if it has one.
  * Does nothing if not.
@@ -125,19 +282,99 @@ void callGcMark(zvalue value);
  */
 void classBindMethods(zvalue cls, zvalue classMethods, zvalue instanceMethods);
 
+/**
+ * Clears the method cache, and invalidates all inline caches. This has to be
+ * done whenever methods get bound and whenever a class might have been
+ * freed, that is, during every gc.
+ */
+void classClearMethodCache(void);
+
+/**
+ * Like `classFindMethodUnchecked()`, except that it takes the method name
+ * as a symbol and first looks in (and then updates) the given inline cache.
+ */
+zvalue classFindMethodCached(zcallCache *cache, zvalue cls, zvalue name);
+
 /**
  * Finds a method on a class, if bound. Returns the bound function if found
  * or `NULL` if not. Does not check to see if `cls` is actually a class,
  * and does not check if `index` is in the valid range for a symbol index.
+ * Results are cached, keyed by class and index.
  */
 zvalue classFindMethodUnchecked(zvalue cls, zint index);
 
+/**
+ * Gets the name of a class, as a symbol. This is `NULL` for classes that
+ * are still being bootstrapped. Does not check to see if `cls` is actually
+ * a class.
+ */
+zvalue classNameUnchecked(zvalue cls);
+
+/**
+ * Gets the largest number of references that have ever been on the frame
+ * stack at once.
+ */
+zint frameStackHighWater(void);
+
 /**
  * Marks all the references on the frame stack. Returns the number of
  * references marked.
  */
 zint markFrameStack(void);
 
+/**
+ * Marks the values referred to by the pending tail call, if any.
+ */
+void callMark(void);
+
+/**
+ * This is the function that handles emitting a context string for a method
+ * call, when dumping the stack. Its `state` is a `StackTraceEntry *`.
+ */
+char *callReporter(void *state);
+
+/**
+ * Blocks profiling signals on the current thread. This is used for threads
+ * which never run in-model code, such as gc threads.
+ */
+void profileBlockThread(void);
+
+/**
+ * Symbolizes any raw profiling samples, if not already in the middle of
+ * doing so.
+ */
+void profileDrain(void);
+
+/**
+ * Indicates to the profiler that a gc has finished.
+ */
+void profileGcEnd(void);
+
+/**
+ * Indicates to the profiler that a gc is starting. Until the corresponding
+ * `profileGcEnd()`, samples just get attributed to gc.
+ */
+void profileGcStart(void);
+
+/**
+ * Marks the values referred to by raw profiling samples.
+ */
+void profileMark(void);
+
+/**
+ * Returns whether the given value has been marked, during a gc. This is
+ * for use by weak tables, between marking and sweeping. It is also valid
+ * outside of gc, but the result is of limited use then (see `alloc.c`).
+ */
+bool gcIsMarked(zvalue value);
+
+/**
+ * Removes unlisted symbols that did not get marked from the table of all
+ * symbols, freeing their indices for reuse. This is called during gc,
+ * after marking and before sweeping.
+ */
+void symbolPruneUnlisted(void);
+
 /**
  * Gets the value for the given symbol key in the given symbol table.
  * Does not check to see if `symtab` is in fact a symbol table.
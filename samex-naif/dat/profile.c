@@ -0,0 +1,395 @@
+// Copyright 2013-2014 the Samizdat Authors (Dan Bornstein et alia).
+// Licensed AS IS and WITHOUT WARRANTY under the Apache License,
+// Version 2.0. Details: <http://www.apache.org/licenses/LICENSE-2.0>
+
+//
+// Sampling profiler
+//
+// A `SIGPROF` timer periodically interrupts the process. The signal handler
+// walks the chain of stack giblets, recording the raw target and method
+// name of each method call in progress, without allocating anything. The
+// next method call to come along turns those raw samples into strings
+// (which can call methods, and so can't be done in the handler), and adds
+// them to a table of counts. At exit, the table is written out in the
+// "folded stack" format used by flame graph tools.
+//
+
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#include "type/Symbol.h"
+#include "type/define.h"
+
+#include "impl.h"
+
+
+//
+// Private Definitions
+//
+
+/**
+ * A raw sample, as recorded by the signal handler.
+ */
+typedef struct {
+    /** Number of frames recorded. */
+    zint depth;
+
+    /** Whether the stack was deeper than could be recorded. */
+    bool truncated;
+
+    /** The frames, innermost first. */
+    StackTraceEntry frames[DAT_PROFILE_MAX_DEPTH];
+} RawSample;
+
+/**
+ * Entry in the table of folded stacks.
+ */
+typedef struct {
+    /** The stack, as a folded string (outermost frame first). */
+    char *stack;
+
+    /** How many samples had this stack. */
+    zint count;
+} FoldedEntry;
+
+/** Path of the file to write the profile to, or `NULL` if not profiling. */
+static char *profilePath = NULL;
+
+/** Raw samples waiting to be symbolized. */
+static RawSample pending[DAT_PROFILE_PENDING_SIZE];
+
+/** Whether a gc is in progress. */
+static volatile sig_atomic_t gcActive = false;
+
+/** Whether raw samples are being symbolized. */
+static volatile sig_atomic_t draining = false;
+
+/** Number of samples taken while a gc was in progress. */
+static volatile zint gcSamples = 0;
+
+/** Number of samples taken while raw samples were being symbolized. */
+static volatile zint drainSamples = 0;
+
+/** Number of samples dropped for lack of space. */
+static volatile zint droppedSamples = 0;
+
+/** Table of folded stacks. */
+static FoldedEntry *folded = NULL;
+
+/** Number of entries in use in `folded`. */
+static zint foldedSize = 0;
+
+/** How many entries `folded` can hold. Always a power of two. */
+static zint foldedMax = 0;
+
+/**
+ * Returns a hash of the given string (FNV-1a).
+ */
+static uint64_t hashString(const char *string) {
+    uint64_t result = 0xcbf29ce484222325ULL;
+
+    for (/*string*/; *string != '\0'; string++) {
+        result = (result ^ (uint8_t) *string) * 0x100000001b3ULL;
+    }
+
+    return result;
+}
+
+/**
+ * Finds the entry for the given stack in the given table (of the given
+ * size), returning a pointer to it, or to the empty slot where it belongs.
+ */
+static FoldedEntry *findFolded(FoldedEntry *table, zint max,
+        const char *stack) {
+    zint mask = max - 1;
+
+    for (zint i = hashString(stack) & mask; /*i*/; i = (i + 1) & mask) {
+        FoldedEntry *one = &table[i];
+
+        if ((one->stack == NULL) || (strcmp(one->stack, stack) == 0)) {
+            return one;
+        }
+    }
+}
+
+/**
+ * Adds one count for the given stack to the table, taking ownership of
+ * the string. The table is grown as necessary, so as to always be at least
+ * half empty.
+ */
+static void addFolded(char *stack) {
+    if ((foldedSize * 2) >= foldedMax) {
+        zint newMax = (foldedMax == 0)
+            ? DAT_PROFILE_TABLE_MIN_SIZE
+            : foldedMax * 2;
+        FoldedEntry *newTable = utilAlloc(newMax * sizeof(FoldedEntry));
+
+        for (zint i = 0; i < foldedMax; i++) {
+            if (folded[i].stack != NULL) {
+                *findFolded(newTable, newMax, folded[i].stack) = folded[i];
+            }
+        }
+
+        utilFree(folded);
+        folded = newTable;
+        foldedMax = newMax;
+    }
+
+    FoldedEntry *entry = findFolded(folded, foldedMax, stack);
+
+    if (entry->stack == NULL) {
+        entry->stack = stack;
+        foldedSize++;
+    } else {
+        utilFree(stack);
+    }
+
+    entry->count++;
+}
+
+/**
+ * Returns a `utilAlloc()`ed string which is the concatenation of the
+ * given (up to) three strings, any of which may be `NULL`.
+ */
+static char *concat3(const char *s1, const char *s2, const char *s3) {
+    zint len1 = (s1 == NULL) ? 0 : strlen(s1);
+    zint len2 = (s2 == NULL) ? 0 : strlen(s2);
+    zint len3 = (s3 == NULL) ? 0 : strlen(s3);
+    char *result = utilAlloc(len1 + len2 + len3 + 1);
+
+    utilCpy(char, result, s1, len1);
+    utilCpy(char, result + len1, s2, len2);
+    utilCpy(char, result + len1 + len2, s3, len3);
+    return result;
+}
+
+/**
+ * Returns a `utilAlloc()`ed string of the name of the given symbol, or
+ * a copy of `defaultName` if it is `NULL`.
+ */
+static char *symbolName(zvalue symbol, const char *defaultName) {
+    return (symbol == NULL)
+        ? utilStrdup(defaultName)
+        : utf8DupFromZstring(zstringFromSymbol(symbol));
+}
+
+/**
+ * Returns a `utilAlloc()`ed string describing the given frame. This is
+ * analogous to `callReporter()`, but more compact.
+ */
+static char *frameName(StackTraceEntry *ste) {
+    char *clsName =
+        symbolName(classNameUnchecked(classOf(ste->target)), "(unnamed)");
+    char *result;
+
+    if (symbolEq(ste->name, SYM(call))) {
+        // It's a function call (or function-like call).
+        zvalue targetName = METH_CALL(ste->target, debugSymbol);
+
+        if (targetName != NULL) {
+            result = symbolName(targetName, NULL);
+        } else {
+            result = concat3("(anonymous ", clsName, ")");
+        }
+    } else {
+        char *methName = symbolName(ste->name, NULL);
+        result = concat3(clsName, ".", methName);
+        utilFree(methName);
+    }
+
+    utilFree(clsName);
+    return result;
+}
+
+/**
+ * Symbolizes the given raw sample, and adds it to the table of folded
+ * stacks.
+ */
+static void addSample(RawSample *sample) {
+    char *stack = utilStrdup(sample->truncated ? "(truncated)" : "(root)");
+
+    for (zint i = sample->depth - 1; i >= 0; i--) {
+        char *name = frameName(&sample->frames[i]);
+        char *newStack = concat3(stack, ";", name);
+
+        utilFree(stack);
+        utilFree(name);
+        stack = newStack;
+    }
+
+    addFolded(stack);
+}
+
+/**
+ * Signal handler which takes a raw sample. This must not allocate or call
+ * into any code that isn't async-signal-safe.
+ */
+static void takeSample(int signum) {
+    if (gcActive) {
+        gcSamples++;
+        return;
+    } else if (draining) {
+        drainSamples++;
+        return;
+    } else if (profilePendingCount == DAT_PROFILE_PENDING_SIZE) {
+        droppedSamples++;
+        return;
+    }
+
+    RawSample *sample = &pending[profilePendingCount];
+    zint depth = 0;
+    UtilStackGiblet *giblet;
+
+    for (giblet = utilStackTop;
+            (giblet != NULL) && (giblet->magic == UTIL_GIBLET_MAGIC);
+            giblet = giblet->pop) {
+        if (giblet->function != callReporter) {
+            continue;
+        } else if (depth == DAT_PROFILE_MAX_DEPTH) {
+            break;
+        }
+
+        sample->frames[depth] = *((StackTraceEntry *) giblet->state);
+        depth++;
+    }
+
+    if (depth == 0) {
+        // Not in any method call (e.g., still booting).
+        return;
+    }
+
+    sample->depth = depth;
+    sample->truncated = (giblet != NULL);
+    profilePendingCount++;
+}
+
+/**
+ * Stops the profiling timer, and writes out the profile. This is called
+ * via `atexit()`.
+ */
+static void writeProfile(void) {
+    setitimer(ITIMER_PROF, &(struct itimerval) {{0, 0}, {0, 0}}, NULL);
+
+    if (!(gcActive || draining)) {
+        profileDrain();
+    }
+
+    FILE *file = fopen(profilePath, "w");
+
+    if (file == NULL) {
+        note("Could not write profile: %s", profilePath);
+        return;
+    }
+
+    for (zint i = 0; i < foldedMax; i++) {
+        FoldedEntry *one = &folded[i];
+
+        if (one->stack != NULL) {
+            fprintf(file, "%s %lld\n", one->stack, one->count);
+        }
+    }
+
+    if (gcSamples != 0) {
+        fprintf(file, "(root);(gc) %lld\n", gcSamples);
+    }
+
+    if (drainSamples != 0) {
+        fprintf(file, "(root);(profiler) %lld\n", drainSamples);
+    }
+
+    fclose(file);
+
+    if (droppedSamples != 0) {
+        note("Profile: Dropped %lld samples.", droppedSamples);
+    }
+}
+
+
+//
+// Module Definitions
+//
+
+// Documented in header.
+volatile sig_atomic_t profilePendingCount = 0;
+
+// Documented in header.
+void profileBlockThread(void) {
+    sigset_t set;
+
+    sigemptyset(&set);
+    sigaddset(&set, SIGPROF);
+    pthread_sigmask(SIG_BLOCK, &set, NULL);
+}
+
+// Documented in header.
+void profileDrain(void) {
+    if (draining) {
+        return;
+    }
+
+    draining = true;
+    zstackPointer save = datFrameStart();
+
+    for (zint i = 0; i < profilePendingCount; i++) {
+        addSample(&pending[i]);
+    }
+
+    datFrameReturn(save, NULL);
+    profilePendingCount = 0;
+    draining = false;
+}
+
+// Documented in header.
+void profileGcEnd(void) {
+    gcActive = false;
+}
+
+// Documented in header.
+void profileGcStart(void) {
+    gcActive = true;
+}
+
+// Documented in header.
+void profileMark(void) {
+    for (zint i = 0; i < profilePendingCount; i++) {
+        RawSample *sample = &pending[i];
+
+        for (zint j = 0; j < sample->depth; j++) {
+            datMark(sample->frames[j].target);
+            datMark(sample->frames[j].name);
+        }
+    }
+}
+
+
+//
+// Exported Definitions
+//
+
+// Documented in header.
+void datProfileStart(const char *path) {
+    if (profilePath != NULL) {
+        die("Profiling already started.");
+    }
+
+    profilePath = utilStrdup(path);
+    atexit(writeProfile);
+
+    struct sigaction action = {.sa_handler = takeSample};
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+
+    if (sigaction(SIGPROF, &action, NULL) != 0) {
+        die("Could not set up profiling signal handler.");
+    }
+
+    struct timeval interval = {0, DAT_PROFILE_INTERVAL_USEC};
+    struct itimerval timer = {interval, interval};
+
+    if (setitimer(ITIMER_PROF, &timer, NULL) != 0) {
+        die("Could not start profiling timer.");
+    }
+}
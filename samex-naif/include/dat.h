@@ -24,8 +24,22 @@
 //
 
 enum {
-    /** Maximum number of symbols allowed. */
-    DAT_MAX_SYMBOLS = 6000
+    /** Number of recent gc cycles kept track of in `DatGcStats`. */
+    DAT_GC_HISTORY_SIZE = 32,
+
+    /**
+     * Number of buckets in the gc pause time histogram. Bucket `n` counts
+     * pauses that took under `2^n` microseconds (and, other than bucket `0`,
+     * at least `2^(n-1)`). The last bucket also counts all longer pauses.
+     */
+    DAT_GC_PAUSE_BUCKETS = 24,
+
+    /**
+     * Bit which, when set in a `zvalue`, indicates that it is an immediate
+     * int rather than a pointer to a heap-allocated value. Heap values are
+     * always aligned, so they never have this bit set. See `Int.c`.
+     */
+    DAT_IMMEDIATE_INT_TAG = 1
 };
 
 /**
@@ -35,13 +49,84 @@ enum {
  * * **Note:** This must match the definition of `DatHeader` in `dat/impl.h`.
  */
 typedef struct {
-    zvalue private1;
-    zvalue private2;
     zvalue cls;
-    int private4 : 1;
+    bool private1 : 1;
+    bool private2 : 1;
     void *payload[/*flexible*/];
 } DatHeaderExposed;
 
+/**
+ * Allocation statistics for a single class. See `datGetClassStats()`.
+ */
+typedef struct {
+    /**
+     * The class. `NULL` indicates the totals for all classes which have
+     * since been freed.
+     */
+    zvalue cls;
+
+    /** Number of instances allocated. */
+    zint count;
+
+    /** Number of bytes allocated for instances. */
+    zint bytes;
+} DatClassStats;
+
+/**
+ * Information about a single gc cycle. See `DatGcStats`.
+ */
+typedef struct {
+    /** Whether it was a major gc. */
+    bool major;
+
+    /** How long it took, in microseconds. */
+    zint pauseUsec;
+
+    /** Number of bytes live in the heap once it was done. */
+    zint liveBytes;
+} DatGcCycle;
+
+/**
+ * Overall allocation and gc statistics. See `datGetGcStats()`.
+ */
+typedef struct {
+    /** Number of values allocated. */
+    zint allocCount;
+
+    /** Number of bytes allocated. */
+    zint allocBytes;
+
+    /** Number of gcs performed. */
+    zint gcCount;
+
+    /** How many of the gcs were major. */
+    zint majorGcCount;
+
+    /** Total time spent in gc, in microseconds. */
+    zint totalPauseUsec;
+
+    /** Longest single gc, in microseconds. */
+    zint maxPauseUsec;
+
+    /** Histogram of gc times. See `DAT_GC_PAUSE_BUCKETS`. */
+    zint pauseHistogram[DAT_GC_PAUSE_BUCKETS];
+
+    /** Number of bytes live in the heap after the most recent gc. */
+    zint liveBytes;
+
+    /** Largest value `liveBytes` has ever had. */
+    zint peakLiveBytes;
+
+    /** Largest number of values ever on the frame stack at once. */
+    zint frameStackHighWater;
+
+    /** Number of elements of `recentCycles` which are valid. */
+    zint recentCount;
+
+    /** The most recent gc cycles, in order from oldest to newest. */
+    DatGcCycle recentCycles[DAT_GC_HISTORY_SIZE];
+} DatGcStats;
+
 
 //
 // Assertion Declarations
@@ -90,6 +175,18 @@ zvalue datAllocValue(zvalue cls, zint extraBytes);
  */
 void datGc(void);
 
+/**
+ * Gets per-class allocation statistics, storing up to `max` elements into
+ * `result`. Returns the total number of elements available, which may
+ * be larger than `max`. The elements are in no particular order.
+ */
+zint datGetClassStats(zint max, DatClassStats *result);
+
+/**
+ * Gets the overall allocation and gc statistics.
+ */
+void datGetGcStats(DatGcStats *result);
+
 /**
  * Marks the given value as "immortal." It is considered a root and
  * will never get freed. Returns `value`, to aid in cascading calls (avoiding
@@ -97,10 +194,30 @@ void datGc(void);
  */
 zvalue datImmortalize(zvalue value);
 
+/**
+ * Forces a gc, and then seals everything that survived it, moving it into
+ * a permanent space. Sealed values are never freed, and (except for ones
+ * that get written to after sealing) are never looked at again during gc.
+ * This is meant to be called once the system has finished bootstrapping,
+ * so that the core library doesn't have to be re-marked on every gc.
+ */
+void datSealHeap(void);
+
+/**
+ * Notes that a reference to another value was stored into the given
+ * already-allocated `value`. This must be called after any such store
+ * into a value that might have survived a gc since it was allocated,
+ * before the next allocation that could lead to a gc. This includes
+ * "mutable" values (such as boxes) and values whose construction performs
+ * allocation after the construction of the value itself.
+ */
+void datWriteBarrier(zvalue value);
+
 /**
  * Marks a value during garbage collection. This in turn calls a class-specific
  * mark function when appropriate and may recurse arbitrarily. It is valid
- * to pass `NULL` to this, but no other non-values are acceptable.
+ * to pass `NULL` to this, but no other non-values are acceptable. Immediate
+ * ints are valid, and marking one is a no-op.
  */
 void datMark(zvalue value);
 
@@ -128,18 +245,49 @@ inline zvalue datNonVoid(zvalue value) {
 }
 
 /**
- * Gets a pointer to the data payload of a `zvalue`.
+ * Returns whether the given value is an immediate int, that is, one encoded
+ * directly in the `zvalue` bits. Immediate ints have neither a header nor a
+ * payload, and they are never allocated, marked, or freed.
+ */
+inline bool datIsImmediateInt(zvalue value) {
+    return (((intptr_t) (void *) value) & DAT_IMMEDIATE_INT_TAG) != 0;
+}
+
+/**
+ * Gets a pointer to the data payload of a `zvalue`. `value` must not be
+ * an immediate int.
  */
 inline void *datPayload(zvalue value) {
     return ((DatHeaderExposed *) (void *) value)->payload;
 }
 
+/**
+ * Class value for in-model class `Int`. This is declared here (and not just
+ * in `type/Int.h`) for the sake of `classOf()`.
+ */
+extern zvalue CLS_Int;
+
 /**
  * Gets the class of the given value. `value` must be a valid value (in
  * particular, non-`NULL`). The return value is of class `Class`.
  */
 inline zvalue classOf(zvalue value) {
-    return ((DatHeaderExposed *) (void *) value)->cls;
+    return datIsImmediateInt(value)
+        ? CLS_Int
+        : ((DatHeaderExposed *) (void *) value)->cls;
 }
 
+
+//
+// Profiling Declarations
+//
+
+/**
+ * Starts the sampling profiler. Samples of the in-model call stack are
+ * taken periodically (based on CPU time used), and when the process exits,
+ * they are written to the file at the given `path`, in the "folded stack"
+ * format used by flame graph tools.
+ */
+void datProfileStart(const char *path);
+
 #endif
@@ -9,6 +9,35 @@
 #ifndef _DAT_CALL_H_
 #define _DAT_CALL_H_
 
+enum {
+    /** Number of classes a `zcallCache` can hold. */
+    DAT_CALL_CACHE_SIZE = 4
+};
+
+/**
+ * Inline method cache, for use at a single method call site. This maps
+ * receiver classes to the functions bound for a particular method name, so
+ * that repeated calls from the same site can skip method lookup. Instances
+ * must be zero-initialized before first use, and must only be used with
+ * `methCallCached()`.
+ */
+typedef struct {
+    /** Method cache epoch when this cache was filled in. See `Class.c`. */
+    zint epoch;
+
+    /** Method name that the entries are for. */
+    zvalue name;
+
+    /** Number of valid entries. */
+    zint size;
+
+    /** Receiver classes. */
+    zvalue classes[DAT_CALL_CACHE_SIZE];
+
+    /** Bound functions, corresponding to `classes`. */
+    zvalue functions[DAT_CALL_CACHE_SIZE];
+} zcallCache;
+
 /**
  * Calls the method `name` on target `target`, with the given list of
  * `args`. `name` must be a symbol, and `args` must be a list or `NULL` (the
@@ -28,6 +57,32 @@ zvalue methApply(zvalue target, zvalue name, zvalue args);
  */
 zvalue methCall(zvalue target, zvalue name, zarray args);
 
+/**
+ * Like `methCall()`, except that method lookup is done using the given
+ * inline cache, which is updated as needed. This is meant for use by
+ * interpreters, with one cache per call site. References held by the cache
+ * are weak; caches get invalidated by every gc, so the cache does not need
+ * to be marked.
+ */
+zvalue methCallCached(zcallCache *cache, zvalue target, zvalue name,
+        zarray args);
+
+/**
+ * Arranges for a tail call of the method `name` on target `target`, with
+ * the given list of `args`. This is just like `methCall()`, except that the
+ * call is made only after the caller has returned, in order to keep
+ * chains of tail calls from growing the C stack. If `mustBeValue` is
+ * `true`, then the call dies if it returns void.
+ *
+ * The result of this function *must* be returned directly (and without
+ * further ado) from a function or method implementation, so that it ends
+ * up being returned from the method dispatch code within `methCall()` or
+ * `methCallCached()`, which is what makes the actual call. Until then, no
+ * allocation may take place.
+ */
+zvalue methTailCall(zvalue target, zvalue name, zarray args,
+        bool mustBeValue);
+
 /**
  * Function which should never get called. This is used to wrap calls which
  * aren't allowed to return. Should they return, this function gets called
@@ -70,6 +125,16 @@ zvalue mustNotYield(zvalue value)
     methCall(func, SYM(call), \
         (zarray) {CALL_ARG_COUNT(__VA_ARGS__), CALL_ARG_ARRAY(__VA_ARGS__)})
 
+/**
+ * `FUN_TAIL_CALL(function, arg, ...)`: Sets up a tail call of a function,
+ * with a variable number of arguments passed in the usual C style. The
+ * call is allowed to return void. See `methTailCall()` for restrictions.
+ */
+#define FUN_TAIL_CALL(func, ...) \
+    methTailCall(func, SYM(call), \
+        (zarray) {CALL_ARG_COUNT(__VA_ARGS__), CALL_ARG_ARRAY(__VA_ARGS__)}, \
+        false)
+
 /**
  * `METH_APPLY(target, name, args)`: Calls a method by (unadorned) name,
  * with a variable number of arguments passed as a list.
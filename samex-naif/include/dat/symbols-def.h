@@ -15,6 +15,7 @@
 DEF_SYMBOL(Bool);
 DEF_SYMBOL(Box);
 DEF_SYMBOL(Builtin);
+DEF_SYMBOL(Bytecode);
 DEF_SYMBOL(Cell);
 DEF_SYMBOL(Class);
 DEF_SYMBOL(Closure);
@@ -27,7 +28,9 @@ DEF_SYMBOL(Int);
 DEF_SYMBOL(Jump);
 DEF_SYMBOL(Lazy);
 DEF_SYMBOL(List);
+DEF_SYMBOL(ListNode);
 DEF_SYMBOL(Map);
+DEF_SYMBOL(MapNode);
 DEF_SYMBOL(Metaclass);
 DEF_SYMBOL(Null);
 DEF_SYMBOL(NullBox);
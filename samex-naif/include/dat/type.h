@@ -57,4 +57,12 @@ typedef struct {
  */
 typedef zvalue (*zfunction)(zvalue thisFunction, zarray args);
 
+/**
+ * Prototype for an underlying C function corresponding to an in-model
+ * function which is bound as a method. This is the same as `zfunction`,
+ * except that the method's target is passed separately as `ths`, instead
+ * of being the first element of `args`.
+ */
+typedef zvalue (*zmethod)(zvalue thisFunction, zvalue ths, zarray args);
+
 #endif
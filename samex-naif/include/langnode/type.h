@@ -49,14 +49,29 @@ typedef enum {
     NODE_CH_STAR    // For formal argument repetition.
 } znodeType;
 
-/** Mapping from `Symbol` index to corresponding `znodeType`. */
-extern znodeType nodeSymbolMap[DAT_MAX_SYMBOLS];
+/**
+ * Mapping from `Symbol` index to corresponding `znodeType`. Only covers
+ * the symbols that existed when the module was initialized, which includes
+ * all the ones with a corresponding `znodeType`.
+ */
+extern znodeType *nodeSymbolMap;
+
+/** Number of elements in `nodeSymbolMap`. */
+extern zint nodeSymbolMapSize;
+
+/**
+ * Gets the evaluation type (enumerated value) of the symbol with the given
+ * index. Returns `0` (not a valid type) if there is no corresponding type.
+ */
+inline znodeType nodeIndexType(zint index) {
+    return (index < nodeSymbolMapSize) ? nodeSymbolMap[index] : 0;
+}
 
 /**
  * Gets the evaluation type (enumerated value) of the given record.
  */
 inline znodeType nodeRecType(zvalue record) {
-    return nodeSymbolMap[recNameIndex(record)];
+    return nodeIndexType(recNameIndex(record));
 }
 
 /**
@@ -70,7 +85,7 @@ inline bool nodeRecTypeIs(zvalue record, znodeType type) {
  * Gets the evaluation type (enumerated value) of the given symbol.
  */
 inline znodeType nodeSymbolType(zvalue symbol) {
-    return nodeSymbolMap[symbolIndex(symbol)];
+    return nodeIndexType(symbolIndex(symbol));
 }
 
 #endif
@@ -34,6 +34,16 @@ typedef struct {
 zvalue makeBuiltin(zint minArgs, zint maxArgs, zfunction function,
     zint stateSize, zvalue name);
 
+/**
+ * Like `makeBuiltin()`, except that the result additionally has a
+ * method entry point `method`, which is used when the builtin is called
+ * as a method. `method` must behave identically to `function`, other than
+ * taking the method target as a separate argument. `minArgs` must be
+ * positive, as the target counts as an argument.
+ */
+zvalue makeBuiltinMethod(zint minArgs, zint maxArgs, zfunction function,
+    zmethod method, zint stateSize, zvalue name);
+
 /**
  * Gets the mutable state of the given builtin.
  */
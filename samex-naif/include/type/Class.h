@@ -59,6 +59,18 @@ zvalue makeClass(zvalue name, zvalue parent,
 zvalue makeCoreClass(zvalue name, zvalue parent,
         zvalue classMethods, zvalue instanceMethods);
 
+/**
+ * Declares that the `gcMark` method currently bound by the given class is
+ * safe to call from multiple threads at once. This allows values of the
+ * class (and of any subclass that doesn't override `gcMark`) to be marked
+ * by parallel gc threads. Any other `gcMark` calls get serialized.
+ *
+ * To qualify, a `gcMark` method must do nothing but read its value's
+ * payload and pass references to `datMark()` (or to functions that do only
+ * that, such as `frameMark()`).
+ */
+void classSetThreadSafeGcMark(zvalue cls);
+
 /**
  * Performs the equivalent of the class method call
  * `Class.typeAccepts(cls, value)`.
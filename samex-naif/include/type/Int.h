@@ -27,7 +27,9 @@ extern zvalue INT_NEG1;
 /**
  * Gets an int value equal to the given `zint`. In this
  * implementation, ints are restricted to only taking on the range
- * of 64-bit signed twos-complement integers.
+ * of 64-bit signed twos-complement integers. Ints in the 63-bit signed
+ * range are immediate (see `datIsImmediateInt()`) and so don't require
+ * allocation.
  */
 zvalue intFromZint(zint value);
 
@@ -13,6 +13,7 @@
 #include <stdbool.h>
 
 #include "type/Value.h"
+#include "util.h"
 
 
 /** Class value for in-model class `Jump`. */
@@ -29,8 +30,12 @@ zvalue makeJump(void);
  * can access it.
  */
 typedef struct {
-    /** Environment struct for use with `sigsetjmp` et al. */
-    sigjmp_buf env;
+    /**
+     * Environment struct for use with `_setjmp` et al. These are used
+     * instead of `sigsetjmp` et al, since jumps never need to restore the
+     * signal mask.
+     */
+    jmp_buf env;
 
     /** Whether the function is valid / usable (in scope, dynamically). */
     bool valid;
@@ -40,14 +45,18 @@ typedef struct {
 } JumpInfo;
 
 /**
- * Sets the return point for the given nonlocal jump.
+ * Sets the return point for the given nonlocal jump. Upon being jumped to,
+ * this restores the stack of giblets (see `UTIL_TRACE_START()`), which
+ * would otherwise be left pointing at the abandoned frames.
  */
 #define jumpArm(jump) \
     do { \
         JumpInfo *info = datPayload((jump)); \
         zstackPointer save = datFrameStart(); \
-        if (sigsetjmp(info->env, 0)) { \
+        UtilStackGiblet *saveGiblet = utilStackTop; \
+        if (_setjmp(info->env)) { \
             zvalue result = info->result; \
+            utilStackTop = saveGiblet; \
             datFrameReturn(save, result); \
             return result; \
         } \
@@ -25,6 +25,13 @@ extern zvalue EMPTY_LIST;
  */
 zvalue listAppend(zvalue list, zvalue elem);
 
+/**
+ * Returns a list with the same elements as the given one, which is
+ * guaranteed to be stored flat (that is, not as a tree). This returns
+ * `list` itself if it is already flat.
+ */
+zvalue listFlatten(zvalue list);
+
 /**
  * Constructs a list of size 1 from a single given `value`.
  */
@@ -42,8 +49,11 @@ zvalue listFromZarray(zarray arr);
 zvalue listPrepend(zvalue elem, zvalue list);
 
 /**
- * Gets a `zarray` of the given list. The result `elems` shares storage
- * with the `list`. As such, it is important to *not* modify the contents.
+ * Gets a `zarray` of the given list. For a flat list, the result `elems`
+ * shares storage with the `list`. As such, it is important to *not* modify
+ * the contents. For a large list built by concatenation, the result is a
+ * copy which is only valid for the duration of the current frame; use
+ * `listFlatten()` first to get an array that lasts as long as the list.
  */
 zarray zarrayFromList(zvalue list);
 
@@ -36,7 +36,9 @@ zvalue mapFromMapping(zmapping mapping);
 
 /**
  * Gets a `zassoc` of the given map. The result `elems` shares storage
- * with `map`. As such, it is important to *not* modify the contents.
+ * with `map` (or, for a large map, with a flat copy of it that lives as
+ * long as the current frame). As such, it is important to *not* modify
+ * the contents.
  */
 zassoc zassocFromMap(zvalue map);
 
@@ -66,6 +66,13 @@ zvalue symbolFromZstring(zstring name);
  */
 zint symbolIndex(zvalue symbol);
 
+/**
+ * Gets the limit of symbol indices, that is, one more than the highest
+ * index that any symbol has (or had). Indices get reused, so this doesn't
+ * change when symbols are freed.
+ */
+zint symbolIndexLimit(void);
+
 /**
  * Sorts an array of symbols by index, in place.
  */
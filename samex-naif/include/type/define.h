@@ -186,10 +186,142 @@
 
 //
 // Method implementation declarations and associated binder. Each of the
-// `METH_IMPL*` macros expands to a `FUNC_IMPL*` macro with one extra
-// argument `ths`. Similarly, each of the `CMETH_IMPL*` results takes
-// an extra argument `thsClass`.
+// `METH_IMPL*` macros is like the corresponding `FUNC_IMPL*` macro with one
+// extra initial argument `ths`. Similarly, each of the `CMETH_IMPL*` results
+// takes an extra initial argument `thsClass`.
 //
+// Unlike plain functions, these get defined with two entry points: The
+// usual function one, and a method one which takes the target separately
+// from the rest of the arguments (see `makeBuiltinMethod()`). The latter is
+// what gets used for regular method calls, which means that the arguments
+// don't have to be copied in order to prepend the target.
+//
+
+/**
+ * Generalized method implementation declaration, used by the
+ * argument-specific ones. `minArgs` and `maxArgs` include the target.
+ */
+#define METHOD_IMPL_MIN_MAX(name, minArgs, maxArgs) \
+    static zvalue METH_##name(zvalue, zvalue, zarray); \
+    static zvalue name(zvalue _function, zarray _args) { \
+        return METH_##name(_function, _args.elems[0], \
+            (zarray) {_args.size - 1, &_args.elems[1]}); \
+    } \
+    static zvalue MAKE_##name(void) { \
+        return makeBuiltinMethod(minArgs, maxArgs, name, METH_##name, 0, \
+            symbolFromUtf8(-1, #name)); \
+    } \
+    static zvalue METH_##name(zvalue _function, zvalue _ths, zarray _args)
+
+#define METHOD_IMPL_0(name, t) \
+    static zvalue IMPL_##name(zvalue); \
+    METHOD_IMPL_MIN_MAX(name, 1, 1) { \
+        return IMPL_##name(_ths); \
+    } \
+    static zvalue IMPL_##name(zvalue t)
+
+#define METHOD_IMPL_1(name, t, a0) \
+    static zvalue IMPL_##name(zvalue, zvalue); \
+    METHOD_IMPL_MIN_MAX(name, 2, 2) { \
+        return IMPL_##name(_ths, _args.elems[0]); \
+    } \
+    static zvalue IMPL_##name(zvalue t, zvalue a0)
+
+#define METHOD_IMPL_2(name, t, a0, a1) \
+    static zvalue IMPL_##name(zvalue, zvalue, zvalue); \
+    METHOD_IMPL_MIN_MAX(name, 3, 3) { \
+        return IMPL_##name(_ths, _args.elems[0], _args.elems[1]); \
+    } \
+    static zvalue IMPL_##name(zvalue t, zvalue a0, zvalue a1)
+
+#define METHOD_IMPL_3(name, t, a0, a1, a2) \
+    static zvalue IMPL_##name(zvalue, zvalue, zvalue, zvalue); \
+    METHOD_IMPL_MIN_MAX(name, 4, 4) { \
+        return IMPL_##name( \
+            _ths, _args.elems[0], _args.elems[1], _args.elems[2]); \
+    } \
+    static zvalue IMPL_##name(zvalue t, zvalue a0, zvalue a1, zvalue a2)
+
+#define METHOD_IMPL_rest(name, t, aRest) \
+    static zvalue IMPL_##name(zvalue, zarray); \
+    METHOD_IMPL_MIN_MAX(name, 1, -1) { \
+        return IMPL_##name(_ths, _args); \
+    } \
+    static zvalue IMPL_##name(zvalue t, zarray aRest)
+
+#define METHOD_IMPL_rest_1(name, t, aRest, a0) \
+    static zvalue IMPL_##name(zvalue, zarray, zvalue); \
+    METHOD_IMPL_MIN_MAX(name, 2, -1) { \
+        return IMPL_##name( \
+            _ths, \
+            (zarray) {_args.size - 1, _args.elems}, \
+            _args.elems[_args.size - 1]); \
+    } \
+    static zvalue IMPL_##name(zvalue t, zarray aRest, zvalue a0)
+
+#define METHOD_IMPL_rest_2(name, t, aRest, a0, a1) \
+    static zvalue IMPL_##name(zvalue, zarray, zvalue, zvalue); \
+    METHOD_IMPL_MIN_MAX(name, 3, -1) { \
+        return IMPL_##name( \
+            _ths, \
+            (zarray) {_args.size - 2, _args.elems}, \
+            _args.elems[_args.size - 2], \
+            _args.elems[_args.size - 1]); \
+    } \
+    static zvalue IMPL_##name(zvalue t, zarray aRest, zvalue a0, zvalue a1)
+
+#define METHOD_IMPL_0_opt(name, t, a0) \
+    static zvalue IMPL_##name(zvalue, zvalue); \
+    METHOD_IMPL_MIN_MAX(name, 1, 2) { \
+        return IMPL_##name( \
+            _ths, \
+            (_args.size > 0) ? _args.elems[0] : NULL); \
+    } \
+    static zvalue IMPL_##name(zvalue t, zvalue a0)
+
+#define METHOD_IMPL_1_opt(name, t, a0, a1) \
+    static zvalue IMPL_##name(zvalue, zvalue, zvalue); \
+    METHOD_IMPL_MIN_MAX(name, 2, 3) { \
+        return IMPL_##name( \
+            _ths, \
+            _args.elems[0], \
+            (_args.size > 1) ? _args.elems[1] : NULL); \
+    } \
+    static zvalue IMPL_##name(zvalue t, zvalue a0, zvalue a1)
+
+#define METHOD_IMPL_1_rest(name, t, a0, aRest) \
+    static zvalue IMPL_##name(zvalue, zvalue, zarray); \
+    METHOD_IMPL_MIN_MAX(name, 2, -1) { \
+        return IMPL_##name( \
+            _ths, \
+            _args.elems[0], \
+            (zarray) {_args.size - 1, &_args.elems[1]}); \
+    } \
+    static zvalue IMPL_##name(zvalue t, zvalue a0, zarray aRest)
+
+#define METHOD_IMPL_2_opt(name, t, a0, a1, a2) \
+    static zvalue IMPL_##name(zvalue, zvalue, zvalue, zvalue); \
+    METHOD_IMPL_MIN_MAX(name, 3, 4) { \
+        return IMPL_##name( \
+            _ths, \
+            _args.elems[0], \
+            _args.elems[1], \
+            (_args.size > 2) ? _args.elems[2] : NULL); \
+    } \
+    static zvalue IMPL_##name(zvalue t, zvalue a0, zvalue a1, zvalue a2)
+
+#define METHOD_IMPL_2_opt_opt(name, t, a0, a1, a2, a3) \
+    static zvalue IMPL_##name(zvalue, zvalue, zvalue, zvalue, zvalue); \
+    METHOD_IMPL_MIN_MAX(name, 3, 5) { \
+        return IMPL_##name( \
+            _ths, \
+            _args.elems[0], \
+            _args.elems[1], \
+            (_args.size > 2) ? _args.elems[2] : NULL, \
+            (_args.size > 3) ? _args.elems[3] : NULL); \
+    } \
+    static zvalue IMPL_##name(zvalue t, zvalue a0, zvalue a1, zvalue a2, \
+            zvalue a3)
 
 // For both class and instance methods.
 
@@ -209,16 +341,20 @@
     SYM(name), \
     FUNC_VALUE(cls##_##name)
 
-#define METH_IMPL_0(cls, name)         FUNC_IMPL_1(cls##_##name, ths)
-#define METH_IMPL_1(cls, name, a0)     FUNC_IMPL_2(cls##_##name, ths, a0)
-#define METH_IMPL_2(cls, name, a0, a1) FUNC_IMPL_3(cls##_##name, ths, a0, a1)
+#define METH_IMPL_0(cls, name)     METHOD_IMPL_0(cls##_##name, ths)
+#define METH_IMPL_1(cls, name, a0) METHOD_IMPL_1(cls##_##name, ths, a0)
+#define METH_IMPL_2(cls, name, a0, a1) \
+    METHOD_IMPL_2(cls##_##name, ths, a0, a1)
+#define METH_IMPL_3(cls, name, a0, a1, a2) \
+    METHOD_IMPL_3(cls##_##name, ths, a0, a1, a2)
 #define METH_IMPL_rest(cls, name, aRest) \
-    FUNC_IMPL_1_rest(cls##_##name, ths, aRest)
-#define METH_IMPL_0_opt(cls, name, a0) FUNC_IMPL_1_opt(cls##_##name, ths, a0)
+    METHOD_IMPL_rest(cls##_##name, ths, aRest)
+#define METH_IMPL_0_opt(cls, name, a0) \
+    METHOD_IMPL_0_opt(cls##_##name, ths, a0)
 #define METH_IMPL_1_opt(cls, name, a0, a1) \
-    FUNC_IMPL_2_opt(cls##_##name, ths, a0, a1)
+    METHOD_IMPL_1_opt(cls##_##name, ths, a0, a1)
 #define METH_IMPL_2_opt(cls, name, a0, a1, a2) \
-    FUNC_IMPL_3_opt(cls##_##name, ths, a0, a1, a2)
+    METHOD_IMPL_2_opt(cls##_##name, ths, a0, a1, a2)
 
 // Class method implementation macros. Structure is identical to the instance
 // method macros, above.
@@ -228,27 +364,29 @@
     FUNC_VALUE(class_##cls##_##name)
 
 #define CMETH_IMPL_0(cls, name) \
-    FUNC_IMPL_1(class_##cls##_##name, thsClass)
+    METHOD_IMPL_0(class_##cls##_##name, thsClass)
 #define CMETH_IMPL_1(cls, name, a0) \
-    FUNC_IMPL_2(class_##cls##_##name, thsClass, a0)
+    METHOD_IMPL_1(class_##cls##_##name, thsClass, a0)
 #define CMETH_IMPL_2(cls, name, a0, a1) \
-    FUNC_IMPL_3(class_##cls##_##name, thsClass, a0, a1)
+    METHOD_IMPL_2(class_##cls##_##name, thsClass, a0, a1)
+#define CMETH_IMPL_3(cls, name, a0, a1, a2) \
+    METHOD_IMPL_3(class_##cls##_##name, thsClass, a0, a1, a2)
 #define CMETH_IMPL_rest(cls, name, aRest) \
-    FUNC_IMPL_1_rest(class_##cls##_##name, thsClass, aRest)
+    METHOD_IMPL_rest(class_##cls##_##name, thsClass, aRest)
 #define CMETH_IMPL_rest_1(cls, name, aRest, a0) \
-    FUNC_IMPL_1_rest_1(class_##cls##_##name, thsClass, aRest, a0)
+    METHOD_IMPL_rest_1(class_##cls##_##name, thsClass, aRest, a0)
 #define CMETH_IMPL_0_opt(cls, name, a0) \
-    FUNC_IMPL_1_opt(class_##cls##_##name, thsClass, a0)
+    METHOD_IMPL_0_opt(class_##cls##_##name, thsClass, a0)
 #define CMETH_IMPL_1_opt(cls, name, a0, a1) \
-    FUNC_IMPL_2_opt(class_##cls##_##name, thsClass, a0, a1)
+    METHOD_IMPL_1_opt(class_##cls##_##name, thsClass, a0, a1)
 #define CMETH_IMPL_1_rest(cls, name, a0, aRest) \
-    FUNC_IMPL_2_rest(class_##cls##_##name, ths, a0, aRest)
+    METHOD_IMPL_1_rest(class_##cls##_##name, ths, a0, aRest)
 #define CMETH_IMPL_2_opt(cls, name, a0, a1, a2) \
-    FUNC_IMPL_3_opt(class_##cls##_##name, thsClass, a0, a1, a2)
+    METHOD_IMPL_2_opt(class_##cls##_##name, thsClass, a0, a1, a2)
 #define CMETH_IMPL_2_opt_opt(cls, name, a0, a1, a2, a3) \
-    FUNC_IMPL_3_opt_opt(class_##cls##_##name, thsClass, a0, a1, a2, a3)
+    METHOD_IMPL_2_opt_opt(class_##cls##_##name, thsClass, a0, a1, a2, a3)
 #define CMETH_IMPL_rest_2(cls, name, aRest, a0, a1) \
-    FUNC_IMPL_1_rest_2(class_##cls##_##name, thsClass, aRest, a0, a1)
+    METHOD_IMPL_rest_2(class_##cls##_##name, thsClass, aRest, a0, a1)
 
 
 //
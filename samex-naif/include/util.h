@@ -55,13 +55,16 @@ extern UtilStackGiblet *utilStackTop;
 
 /**
  * Defines a giblet for the current function. Use this at the point a
- * stack trace for the call would be valid.
+ * stack trace for the call would be valid. The giblet is fully set up before
+ * it becomes the top of the stack, so that it can be examined by a signal
+ * handler (see `datProfileStart()`).
  */
 #define UTIL_TRACE_START(function, state) \
     UtilStackGiblet stackGiblet = { \
         UTIL_GIBLET_MAGIC, utilStackTop, (function), (state) \
     }; \
     do { \
+        __atomic_signal_fence(__ATOMIC_SEQ_CST); \
         utilStackTop = &stackGiblet; \
     } while(0)
 
@@ -100,11 +103,25 @@ void die(const char *format, ...)
  */
 void *utilAlloc(zint size);
 
+/**
+ * Allocates zeroed-out whole pages of memory, directly from the OS, with
+ * at least the indicated size (in bytes). The result is aligned to the
+ * given `alignment`, which must be a power of two. This is meant for
+ * allocators that carve up big blocks for themselves.
+ */
+void *utilAllocPages(zint size, zint alignment);
+
 /**
  * Frees memory previously allocated by `utilAlloc`.
  */
 void utilFree(void *memory);
 
+/**
+ * Returns memory previously allocated by `utilAllocPages` to the OS.
+ * `size` must be the same as was passed to `utilAllocPages`.
+ */
+void utilFreePages(void *memory, zint size);
+
 /**
  * Returns whether this appears to be a pointer to heap-allocated memory
  * (though not necessarily the start of an allocation).
@@ -14,21 +14,72 @@
 /**
  * Struct to hold a sized Unicode string. **Note:** This has a pointer to the
  * characters, not the characters themselves.
+ *
+ * The characters are stored in one of three widths: one byte each (which
+ * can hold Latin-1), two bytes each (which can hold the Basic Multilingual
+ * Plane), or a full `zchar` each. Code which reads the characters should
+ * generally do so via `zstringNth()`.
  */
 typedef struct {
     /** Number of characters in the string. */
     zint size;
 
-    /** The characters. */
-    const zchar *chars;
+    /** Width of each character, in bytes. Always `1`, `2`, or `4`. */
+    zint width;
+
+    /**
+     * The characters, as an array of `uint8_t`, `uint16_t`, or `zchar`,
+     * depending on `width`.
+     */
+    const void *chars;
 } zstring;
 
+/**
+ * Gets the character at the given index of the given `zstring`. Does not
+ * do any bounds checking.
+ */
+inline zchar zstringNth(zstring string, zint n) {
+    switch (string.width) {
+        case 1:  { return ((const uint8_t *) string.chars)[n];  }
+        case 2:  { return ((const uint16_t *) string.chars)[n]; }
+        default: { return ((const zchar *) string.chars)[n];    }
+    }
+}
+
+/**
+ * Gets a `zstring` which refers to the given range of characters of the
+ * given one. Does not do any bounds checking.
+ */
+inline zstring zstringSlice(zstring string, zint start, zint size) {
+    return (zstring) {
+        size,
+        string.width,
+        (const char *) string.chars + (start * string.width)
+    };
+}
+
+/**
+ * Makes a `zstring` which refers to the given array of (full-width)
+ * `zchar`s.
+ */
+inline zstring zstringFromZchars(zint size, const zchar *chars) {
+    return (zstring) {size, sizeof(zchar), chars};
+}
+
 /**
  * Copies all the characters of the given `zstring` into the given result
  * array, which must be sized large enough to hold all of them.
  */
 void arrayFromZstring(zchar *result, zstring string);
 
+/**
+ * Copies all the characters of the given `zstring` into the given result
+ * array, whose characters are of the given width. The array must be sized
+ * large enough to hold all of them, and the width must be at least
+ * `zstringMinWidth(string)`.
+ */
+void arrayFromZstringWidth(void *result, zint width, zstring string);
+
 /**
  * Like `utf8FromZstring`, except this returns an allocated buffer containing
  * the result.
@@ -60,6 +111,12 @@ zint utf8SizeFromZstring(const zstring string);
  */
 bool zstringEq(zstring string1, zstring string2);
 
+/**
+ * Gets the narrowest character width (`1`, `2`, or `4`) which can hold
+ * all the characters of the given `zstring`.
+ */
+zint zstringMinWidth(zstring string);
+
 /**
  * Compares two `zstring`s for order.
  */
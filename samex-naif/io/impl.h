@@ -10,8 +10,11 @@
 #define _IMPL_H_
 
 enum {
-    /** Maximum readable file size, in bytes. */
-    IO_MAX_FILE_SIZE = 100000
+    /**
+     * Initial size in bytes of the buffer used when reading a file. It
+     * gets doubled as needed.
+     */
+    IO_READ_BUFFER_MIN_SIZE = 100000
 };
 
 #endif
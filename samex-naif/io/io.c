@@ -76,21 +76,32 @@ zvalue ioFileType(zvalue path) {
 
 // Documented in header.
 zvalue ioReadFileUtf8(zvalue path) {
-    char buf[IO_MAX_FILE_SIZE];
     FILE *in = openFile(path, "r");
-    size_t amt = fread(buf, 1, sizeof(buf), in);
-
-    if (ferror(in)) {
-        die("Trouble reading file: %s", strerror(errno));
-    }
-
-    if (!feof(in)) {
-        die("Overlong file: %s", strerror(errno));
+    zint max = IO_READ_BUFFER_MIN_SIZE;
+    zint size = 0;
+    char *buf = utilAlloc(max);
+
+    for (;;) {
+        size += fread(buf + size, 1, max - size, in);
+
+        if (ferror(in)) {
+            die("Trouble reading file: %s", strerror(errno));
+        } else if (feof(in)) {
+            break;
+        } else if (size == max) {
+            char *newBuf = utilAlloc(max * 2);
+            utilCpy(char, newBuf, buf, size);
+            utilFree(buf);
+            buf = newBuf;
+            max *= 2;
+        }
     }
 
     fclose(in);
 
-    return stringFromUtf8(amt, buf);
+    zvalue result = stringFromUtf8(size, buf);
+    utilFree(buf);
+    return result;
 }
 
 // Documented in header.
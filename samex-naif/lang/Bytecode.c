@@ -0,0 +1,383 @@
+// Copyright 2013-2014 the Samizdat Authors (Dan Bornstein et alia).
+// Licensed AS IS and WITHOUT WARRANTY under the Apache License,
+// Version 2.0. Details: <http://www.apache.org/licenses/LICENSE-2.0>
+
+//
+// `Bytecode` class, and the bytecode interpreter
+//
+// Instances are compiled from the `statements` and `yield` of a
+// `ClosureNode`. The interpreter is a simple stack machine, with the
+// stack allocated up-front on the C stack. Dispatch is via computed `goto`
+// (a GCC extension, which clang also supports).
+//
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "type/Box.h"
+#include "type/define.h"
+#include "util.h"
+
+#include "impl.h"
+
+
+//
+// Private Definitions
+//
+
+/**
+ * Payload data. The variable-length arrays all live in `data`, with
+ * the various pointers pointing into it.
+ */
+typedef struct {
+    /** Maximum stack size needed to run the code. */
+    zint maxStack;
+
+    /** Number of constants. */
+    zint constsSize;
+
+    /** Constants referred to by the code. Points into `data`. */
+    zvalue *consts;
+
+    /** Inline method caches, for `BC_call`. Points into `data`. */
+    zcallCache *caches;
+
+    /** The code. Points into `data`. */
+    zint *code;
+
+    /** Storage for all of the above. */
+    char data[/*see bcbFinish()*/];
+} BytecodeInfo;
+
+/**
+ * Gets the info of a bytecode value.
+ */
+static BytecodeInfo *getInfo(zvalue value) {
+    return (BytecodeInfo *) datPayload(value);
+}
+
+/**
+ * Makes sure the given builder has room for one more code element.
+ */
+static void growCode(BytecodeBuilder *builder) {
+    if (builder->codeSize < builder->codeMax) {
+        return;
+    }
+
+    zint newMax = (builder->codeMax == 0)
+        ? LANG_BYTECODE_MIN_SIZE
+        : builder->codeMax * 2;
+    zint *newCode = utilAlloc(newMax * sizeof(zint));
+
+    utilCpy(zint, newCode, builder->code, builder->codeSize);
+    utilFree(builder->code);
+    builder->code = newCode;
+    builder->codeMax = newMax;
+}
+
+
+//
+// Module Definitions
+//
+
+// Documented in header.
+bool bytecodeEnabled = true;
+
+// Documented in header.
+void bcbArg(BytecodeBuilder *builder, zint arg) {
+    growCode(builder);
+    builder->code[builder->codeSize] = arg;
+    builder->codeSize++;
+}
+
+// Documented in header.
+zint bcbCache(BytecodeBuilder *builder) {
+    zint result = builder->cachesSize;
+    builder->cachesSize++;
+    return result;
+}
+
+// Documented in header.
+zint bcbConst(BytecodeBuilder *builder, zvalue value) {
+    if (builder->constsSize == builder->constsMax) {
+        zint newMax = (builder->constsMax == 0)
+            ? LANG_BYTECODE_MIN_SIZE
+            : builder->constsMax * 2;
+        zvalue *newConsts = utilAlloc(newMax * sizeof(zvalue));
+
+        utilCpy(zvalue, newConsts, builder->consts, builder->constsSize);
+        utilFree(builder->consts);
+        builder->consts = newConsts;
+        builder->constsMax = newMax;
+    }
+
+    zint result = builder->constsSize;
+    builder->consts[result] = value;
+    builder->constsSize++;
+    return result;
+}
+
+// Documented in header.
+void bcbEmit(BytecodeBuilder *builder, zbytecodeOp op, zint stackDelta) {
+    bcbArg(builder, op);
+    builder->stackSize += stackDelta;
+
+    if (builder->stackSize > builder->maxStack) {
+        builder->maxStack = builder->stackSize;
+    }
+}
+
+// Documented in header.
+zvalue bcbFinish(BytecodeBuilder *builder) {
+    zint constsBytes = builder->constsSize * sizeof(zvalue);
+    zint cachesBytes = builder->cachesSize * sizeof(zcallCache);
+    zint codeBytes = builder->codeSize * sizeof(zint);
+    zvalue result = datAllocValue(CLS_Bytecode,
+        sizeof(BytecodeInfo) + constsBytes + cachesBytes + codeBytes);
+    BytecodeInfo *info = getInfo(result);
+
+    // `datAllocValue()` zeroes the payload, which is what the caches need.
+    info->maxStack = builder->maxStack;
+    info->constsSize = builder->constsSize;
+    info->consts = (zvalue *) info->data;
+    info->caches = (zcallCache *) (info->data + constsBytes);
+    info->code = (zint *) (info->data + constsBytes + cachesBytes);
+
+    utilCpy(zvalue, info->consts, builder->consts, builder->constsSize);
+    utilCpy(zint, info->code, builder->code, builder->codeSize);
+
+    utilFree(builder->code);
+    utilFree(builder->consts);
+    bcbInit(builder);
+
+    return result;
+}
+
+// Documented in header.
+void bcbInit(BytecodeBuilder *builder) {
+    *builder = (BytecodeBuilder) {
+        .code = NULL,
+        .codeSize = 0,
+        .codeMax = 0,
+        .consts = NULL,
+        .constsSize = 0,
+        .constsMax = 0,
+        .cachesSize = 0,
+        .stackSize = 0,
+        .maxStack = 0
+    };
+}
+
+// Documented in header.
+zvalue bytecodeExecute(zvalue bytecode, Frame *frame) {
+    static void *labels[] = {
+        [BC_apply]         = &&op_apply,
+        [BC_box]           = &&op_box,
+        [BC_call]          = &&op_call,
+        [BC_closure]       = &&op_closure,
+        [BC_fallback]      = &&op_fallback,
+        [BC_fetch]         = &&op_fetch,
+        [BC_literal]       = &&op_literal,
+        [BC_noYield]       = &&op_noYield,
+        [BC_nonVoid]       = &&op_nonVoid,
+        [BC_pop]           = &&op_pop,
+        [BC_store]         = &&op_store,
+        [BC_tailCall]      = &&op_tailCall,
+        [BC_varDef]        = &&op_varDef,
+        [BC_varDefUnboxed] = &&op_varDefUnboxed,
+        [BC_varRef]        = &&op_varRef,
+        [BC_varRef0]       = &&op_varRef0,
+        [BC_void]          = &&op_void,
+        [BC_yield]         = &&op_yield
+    };
+
+    BytecodeInfo *info = getInfo(bytecode);
+    zvalue *consts = info->consts;
+    zint *pc = info->code;
+    zvalue stack[info->maxStack];
+    zvalue *sp = stack;  // Points just past the top of the stack.
+
+    #define NEXT() goto *labels[*pc++]
+
+    NEXT();
+
+    op_apply: {
+        zvalue values = sp[-1];
+        zvalue name = sp[-2];
+        zvalue target = sp[-3];
+
+        sp -= 2;
+        sp[-1] = methApply(target, name, values);
+        NEXT();
+    }
+
+    op_box: {
+        sp[-1] = cm_newBox(Result, sp[-1]);
+        NEXT();
+    }
+
+    op_call: {
+        zint argCount = pc[0];
+        zcallCache *cache = &info->caches[pc[1]];
+        zvalue *args = sp - argCount;
+
+        zvalue result = methCallCached(cache, args[-2], args[-1],
+            (zarray) {argCount, args});
+
+        sp = args - 1;
+        sp[-1] = result;
+        pc += 2;
+        NEXT();
+    }
+
+    op_closure: {
+        *sp = exnoBuildClosure(consts[pc[0]], frame, pc[1]);
+        sp++;
+        pc += 2;
+        NEXT();
+    }
+
+    op_fallback: {
+        zexecOperation op = pc[1];
+        zvalue result = exnoExecuteOp(consts[pc[0]], frame, op);
+
+        if (op != EX_statement) {
+            *sp = result;
+            sp++;
+        }
+
+        pc += 2;
+        NEXT();
+    }
+
+    op_fetch: {
+        sp[-1] = cm_fetch(sp[-1]);
+        NEXT();
+    }
+
+    op_literal: {
+        *sp = consts[pc[0]];
+        sp++;
+        pc++;
+        NEXT();
+    }
+
+    op_noYield: {
+        mustNotYield(sp[-1]);
+    }
+
+    op_nonVoid: {
+        if (sp[-1] == NULL) {
+            die("Invalid use of void expression result.");
+        }
+
+        NEXT();
+    }
+
+    op_pop: {
+        sp--;
+        NEXT();
+    }
+
+    op_store: {
+        zvalue value = sp[-1];
+
+        sp--;
+        sp[-1] = cm_store(sp[-1], value);
+        NEXT();
+    }
+
+    op_tailCall: {
+        zint argCount = pc[0];
+        zvalue *args = sp - argCount;
+
+        return methTailCall(args[-2], args[-1], (zarray) {argCount, args},
+            pc[1]);
+    }
+
+    op_varDef: {
+        zvalue cls = consts[pc[1]];
+        zvalue value = sp[-1];
+        zvalue box = (value == NULL)
+            ? METH_CALL(cls, new)
+            : METH_CALL(cls, new, value);
+
+        frameDef(frame, pc[0], box);
+        sp--;
+        pc += 2;
+        NEXT();
+    }
+
+    op_varDefUnboxed: {
+        frameDef(frame, pc[0], sp[-1]);
+        sp--;
+        pc++;
+        NEXT();
+    }
+
+    op_varRef: {
+        *sp = frameGet(frame, pc[0], pc[1]);
+        sp++;
+        pc += 2;
+        NEXT();
+    }
+
+    op_varRef0: {
+        *sp = frame->vars[pc[0]];
+        sp++;
+        pc++;
+        NEXT();
+    }
+
+    op_void: {
+        *sp = NULL;
+        sp++;
+        NEXT();
+    }
+
+    op_yield: {
+        return sp[-1];
+    }
+
+    #undef NEXT
+}
+
+
+//
+// Class Definition
+//
+
+// Documented in header.
+METH_IMPL_0(Bytecode, gcMark) {
+    BytecodeInfo *info = getInfo(ths);
+
+    for (zint i = 0; i < info->constsSize; i++) {
+        datMark(info->consts[i]);
+    }
+
+    return NULL;
+}
+
+/** Initializes the module. */
+MOD_INIT(Bytecode) {
+    MOD_USE(cls);
+
+    const char *name = getenv("SAMEX_INTERPRETER");
+    if ((name == NULL) || (*name == '\0') || (strcmp(name, "bytecode") == 0)) {
+        bytecodeEnabled = true;
+    } else if (strcmp(name, "tree") == 0) {
+        bytecodeEnabled = false;
+    } else {
+        die("Invalid value for SAMEX_INTERPRETER: %s", name);
+    }
+
+    CLS_Bytecode = makeCoreClass(SYM(Bytecode), CLS_Core,
+        NULL,
+        METH_TABLE(
+            METH_BIND(Bytecode, gcMark)));
+
+    classSetThreadSafeGcMark(CLS_Bytecode);
+}
+
+// Documented in header.
+zvalue CLS_Bytecode = NULL;
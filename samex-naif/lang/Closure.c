@@ -30,6 +30,9 @@ typedef struct {
      * closure.
      */
     zvalue node;
+
+    /** Storage for the variables of `frame`. */
+    zvalue vars[/*frame.varsSize*/];
 } ClosureInfo;
 
 /**
@@ -45,12 +48,13 @@ static ClosureInfo *getInfo(zvalue closure) {
 //
 
 // Documented in header.
-zvalue exnoBuildClosure(zvalue node, Frame *frame) {
-    zvalue result = datAllocValue(CLS_Closure, sizeof(ClosureInfo));
+zvalue exnoBuildClosure(zvalue node, Frame *frame, zint varsSize) {
+    zvalue result = datAllocValue(CLS_Closure,
+        sizeof(ClosureInfo) + (varsSize * sizeof(zvalue)));
     ClosureInfo *info = getInfo(result);
 
     info->node = node;
-    frameSnap(&info->frame, frame);
+    frameSnap(&info->frame, frame, info->vars, varsSize);
     return result;
 }
 
@@ -89,6 +93,8 @@ MOD_INIT(Closure) {
             METH_BIND(Closure, call),
             METH_BIND(Closure, debugSymbol),
             METH_BIND(Closure, gcMark)));
+
+    classSetThreadSafeGcMark(CLS_Closure);
 }
 
 // Documented in header.
@@ -7,12 +7,13 @@
 //
 // Translation of the main info of a `closure` node.
 
+#include <sys/resource.h>
+
 #include "langnode.h"
 #include "type/define.h"
 #include "type/Box.h"
 #include "type/Jump.h"
 #include "type/List.h"
-#include "type/SymbolTable.h"
 
 #include "impl.h"
 
@@ -21,6 +22,12 @@
 // Private Definitions
 //
 
+/**
+ * Lowest C stack address at which a closure may be called, or `0` if there
+ * is no limit. Set up in `MOD_INIT(ClosureNode)`.
+ */
+static uintptr_t cStackLimit = 0;
+
 /**
  * Repetition style of a formal argument.
  */
@@ -70,6 +77,26 @@ typedef struct {
 
     /** `node::yieldDef`. */
     zvalue yieldDef;
+
+    /**
+     * Whether `yieldDef` is ever referenced. If not, there's no need to
+     * set up a nonlocal exit when calling the closure. This is the usual
+     * case for a `return` that only appears in tail position, since the
+     * simplifier turns those into plain yields.
+     */
+    bool yieldDefUsed;
+
+    /**
+     * `statements` and `yield` compiled into a `Bytecode`. Only set up
+     * when using the bytecode interpreter, and then lazily, on first call.
+     */
+    zvalue bytecode;
+
+    /**
+     * The number of variables (formals, `yieldDef`, and local variables)
+     * defined in each frame of a call to this closure.
+     */
+    zint varsSize;
 } ClosureNodeInfo;
 
 /**
@@ -101,14 +128,13 @@ static void detectDuplicates(zint size, zvalue *arr, const char *kind) {
  */
 static void convertFormals(ClosureNodeInfo *info, zvalue formalsList) {
     zarray formals = zarrayFromList(formalsList);
-    zarray statements = zarrayFromList(info->statements);
 
     if (formals.size > LANG_MAX_FORMALS) {
         die("Too many formals: %lld", formals.size);
     }
 
     // The `names` array is for detecting duplicates.
-    zvalue names[formals.size + statements.size + 1];
+    zvalue names[formals.size + 1];
     zint nameCount = 0;
 
     if (info->yieldDef != NULL) {
@@ -149,27 +175,15 @@ static void convertFormals(ClosureNodeInfo *info, zvalue formalsList) {
     detectDuplicates(nameCount, names, "formal argument");
     info->formalsSize = formals.size;
     info->formalsNameCount = nameCount;
-
-    // Detect duplicate variable names.
-
-    for (zint i = 0; i < statements.size; i++) {
-        zvalue name = exnoVarDefName(statements.elems[i]);
-        if (name != NULL) {
-            names[nameCount] = name;
-            nameCount++;
-        }
-    }
-
-    detectDuplicates(nameCount, names, "variable");
 }
 
 /**
- * Creates a variable table for all the formal arguments of the given
- * function.
+ * Binds all the formal arguments of the given function, storing their
+ * (unboxed) values into the initial slots of the given `vars`. This is done in the
+ * same order in which `exnoConvertClosure()` defines them.
  */
-static zvalue bindArguments(ClosureNodeInfo *info, zvalue exitFunction,
-        zarray args) {
-    zmapping elems[info->formalsNameCount];
+static void bindArguments(ClosureNodeInfo *info, zvalue exitFunction,
+        zarray args, zvalue *vars) {
     zformal *formals = info->formals;
     zint formalsSize = info->formalsSize;
     zint elemAt = 0;
@@ -219,8 +233,7 @@ static zvalue bindArguments(ClosureNodeInfo *info, zvalue exitFunction,
         }
 
         if (!ignore) {
-            elems[elemAt].key = name;
-            elems[elemAt].value = cm_new(Result, value);
+            vars[elemAt] = value;
             elemAt++;
         }
     }
@@ -231,12 +244,36 @@ static zvalue bindArguments(ClosureNodeInfo *info, zvalue exitFunction,
     }
 
     if (exitFunction != NULL) {
-        elems[elemAt].key = info->yieldDef;
-        elems[elemAt].value = cm_new(Result, exitFunction);
-        elemAt++;
+        vars[elemAt] = exitFunction;
+    }
+}
+
+/**
+ * Compiles the body of the given closure node, storing the result in its
+ * `bytecode`.
+ */
+static void compileBody(zvalue node) {
+    ClosureNodeInfo *info = getInfo(node);
+    BytecodeBuilder builder;
+
+    bcbInit(&builder);
+
+    for (zint i = 0; i < info->statementsArr.size; i++) {
+        exnoCompile(info->statementsArr.elems[i], &builder, EX_statement);
     }
 
-    return symtabFromZassoc((zassoc) {elemAt, elems});
+    // A call in yield position becomes a tail call, except when there is
+    // a nonlocal exit, which has to stay armed until the call returns.
+    if (info->yieldDefUsed) {
+        exnoCompile(info->yield, &builder, EX_maybe);
+    } else {
+        exnoCompileYield(info->yield, &builder);
+    }
+
+    bcbEmit(&builder, BC_yield, -1);
+
+    info->bytecode = bcbFinish(&builder);
+    datWriteBarrier(node);
 }
 
 /**
@@ -246,19 +283,38 @@ static zvalue bindArguments(ClosureNodeInfo *info, zvalue exitFunction,
 static zvalue callClosureMain(zvalue node, Frame *parentFrame,
         zvalue parentClosure, zvalue exitFunction, zarray args) {
     ClosureNodeInfo *info = getInfo(node);
+    char here;
+
+    if ((uintptr_t) &here < cStackLimit) {
+        // Deep recursion. Fail the same way as when running out of value
+        // stack, instead of crashing when the C stack runs out.
+        datFrameError("Value stack overflow.");
+    }
 
     // With the closure's frame as the parent, bind the formals and
     // nonlocal exit (if present), creating a new execution frame.
 
     Frame frame;
-    zvalue argTable = bindArguments(info, exitFunction, args);
-    frameInit(&frame, parentFrame, parentClosure, argTable);
+    zvalue vars[info->varsSize];
+    frameInit(&frame, parentFrame, parentClosure, vars, info->varsSize);
+    bindArguments(info, exitFunction, args, vars);
+
+    if (bytecodeEnabled) {
+        if (info->bytecode == NULL) {
+            compileBody(node);
+        }
+
+        return bytecodeExecute(info->bytecode, &frame);
+    }
 
     // Execute the statements, updating the frame as needed.
     exnoExecuteStatements(info->statementsArr, &frame);
 
-    // Execute the yield expression, and return the final result.
-    return exnoExecute(info->yield, &frame);
+    // Execute the yield expression, and return the final result. See
+    // `compileBody()` about tail calls.
+    return info->yieldDefUsed
+        ? exnoExecute(info->yield, &frame)
+        : exnoExecuteYield(info->yield, &frame);
 }
 
 
@@ -267,31 +323,7 @@ static zvalue callClosureMain(zvalue node, Frame *parentFrame,
 //
 
 // Documented in header.
-zvalue exnoCallClosure(zvalue node, Frame *parentFrame, zvalue parentClosure,
-        zarray args) {
-    if (getInfo(node)->yieldDef == NULL) {
-        return callClosureMain(node, parentFrame, parentClosure, NULL, args);
-    }
-
-    zvalue jump = makeJump();
-    jumpArm(jump);
-
-    zvalue result =
-        callClosureMain(node, parentFrame, parentClosure, jump, args);
-    jumpRetire(jump);
-
-    return result;
-}
-
-
-//
-// Class Definition
-//
-
-/**
- * Constructs an instance from the given (per spec) `closure` tree node.
- */
-CMETH_IMPL_1(ClosureNode, new, orig) {
+zvalue exnoConvertClosure(zvalue orig, Scope *scope) {
     zvalue result = datAllocValue(CLS_ClosureNode, sizeof(ClosureNodeInfo));
     ClosureNodeInfo *info = getInfo(result);
     zvalue formals;
@@ -308,15 +340,66 @@ CMETH_IMPL_1(ClosureNode, new, orig) {
         SYM(name),     &info->name,
         SYM(yieldDef), &info->yieldDef);
 
-    exnoConvert(&info->statements);
-    exnoConvert(&info->yield);
     convertFormals(info, formals);
 
+    // Define the formals and `yieldDef` in the closure's own scope, in the
+    // order that `bindArguments()` binds them, and then convert the body.
+    // Local variables get defined in order as the statements are converted.
+
+    Scope innerScope;
+    scopeInit(&innerScope, scope, NULL);
+
+    for (zint i = 0; i < info->formalsSize; i++) {
+        zvalue name = info->formals[i].name;
+        if (name != NULL) {
+            scopeDef(&innerScope, name, true);
+        }
+    }
+
+    if (info->yieldDef != NULL) {
+        innerScope.yieldDefSlot =
+            scopeDef(&innerScope, info->yieldDef, true);
+    }
+
+    exnoConvert(&info->statements, &innerScope);
+    exnoConvert(&info->yield, &innerScope);
+    info->varsSize = innerScope.size;
+    info->yieldDefUsed = innerScope.yieldDefUsed;
+    scopeFree(&innerScope);
+
+    info->statements = listFlatten(info->statements);
     info->statementsArr = zarrayFromList(info->statements);
 
+    // Conversion of the sub-nodes can allocate, so `result` may have
+    // survived a gc by this point.
+    datWriteBarrier(result);
+    return result;
+}
+
+// Documented in header.
+zvalue exnoCallClosure(zvalue node, Frame *parentFrame, zvalue parentClosure,
+        zarray args) {
+    if (!getInfo(node)->yieldDefUsed) {
+        // Either there's no `yieldDef`, or nothing refers to it. Either
+        // way, its slot (if any) can be left unbound.
+        return callClosureMain(node, parentFrame, parentClosure, NULL, args);
+    }
+
+    zvalue jump = makeJump();
+    jumpArm(jump);
+
+    zvalue result =
+        callClosureMain(node, parentFrame, parentClosure, jump, args);
+    jumpRetire(jump);
+
     return result;
 }
 
+
+//
+// Class Definition
+//
+
 // Documented in spec.
 METH_IMPL_0(ClosureNode, debugSymbol) {
     return getInfo(ths)->name;
@@ -330,6 +413,7 @@ METH_IMPL_0(ClosureNode, gcMark) {
     datMark(info->statements);
     datMark(info->yield);
     datMark(info->yieldDef);
+    datMark(info->bytecode);
 
     for (zint i = 0; i < info->formalsSize; i++) {
         datMark(info->formals[i].name);
@@ -341,14 +425,27 @@ METH_IMPL_0(ClosureNode, gcMark) {
 /** Initializes the module. */
 MOD_INIT(ClosureNode) {
     MOD_USE(cls);
+    MOD_USE(Bytecode);
     MOD_USE(Jump);
 
     CLS_ClosureNode = makeCoreClass(SYM(ClosureNode), CLS_Core,
-        METH_TABLE(
-            CMETH_BIND(ClosureNode, new)),
+        NULL,
         METH_TABLE(
             METH_BIND(ClosureNode, debugSymbol),
             METH_BIND(ClosureNode, gcMark)));
+
+    classSetThreadSafeGcMark(CLS_ClosureNode);
+
+    // Module initialization happens near the base of the C stack, which
+    // grows downward from here.
+    struct rlimit limit;
+    if ((getrlimit(RLIMIT_STACK, &limit) == 0)
+        && (limit.rlim_cur != RLIM_INFINITY)
+        && (limit.rlim_cur > LANG_C_STACK_HEADROOM)) {
+        char here;
+        cStackLimit =
+            (uintptr_t) &here - limit.rlim_cur + LANG_C_STACK_HEADROOM;
+    }
 }
 
 // Documented in header.
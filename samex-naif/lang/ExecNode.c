@@ -12,6 +12,7 @@
 #include "type/define.h"
 #include "type/Box.h"
 #include "type/List.h"
+#include "type/String.h"
 #include "type/SymbolTable.h"
 
 #include "impl.h"
@@ -50,6 +51,36 @@ typedef struct {
 
     /** `zarray` pointer into `values`, when useful. */
     zarray valuesArr;
+
+    /**
+     * For `varRef` nodes (and `fetch` nodes of unboxed variables), how many
+     * frames up the chain the variable is defined, or `-1` if it isn't
+     * defined at all.
+     */
+    zint depth;
+
+    /**
+     * For `varDef` and `varRef` nodes (and `fetch` nodes of unboxed
+     * variables), the frame slot of the variable.
+     */
+    zint slot;
+
+    /**
+     * For `varDef` and `varRef` nodes, whether the variable is unboxed (see
+     * `Frame.vars`). For `fetch` nodes, whether the target is a `varRef` of
+     * an unboxed variable, in which case the fetch is done directly from
+     * the frame.
+     */
+    bool unboxed;
+
+    /**
+     * For `closure` nodes, the number of variables of the enclosing frame
+     * which are in scope for the closure.
+     */
+    zint varsSize;
+
+    /** Inline method cache, for `call` nodes. */
+    zcallCache callCache;
 } ExecNodeInfo;
 
 /**
@@ -59,16 +90,6 @@ static ExecNodeInfo *getInfo(zvalue value) {
     return (ExecNodeInfo *) datPayload(value);
 }
 
-/**
- * Identifies the variant of execution.
- */
-typedef enum {
-    EX_statement,  // Yield ignored; also allows `varDef` and `import*`.
-    EX_value,      // Must yield a value (not void).
-    EX_maybe,      // This allows both `maybe` and `void`.
-    EX_voidOk      // Allowed to yield void.
-} zexecOperation;
-
 /**
  * Executes a single `ExecNode`. `op` identifies the variant. Can return
  * `NULL`.
@@ -98,19 +119,24 @@ static zvalue execute(zvalue node, Frame *frame, zexecOperation op) {
                 args[i] = execute(values.elems[i], frame, EX_value);
             }
 
-            result = methCall(target, name, (zarray) {values.size, args});
+            result = methCallCached(&info->callCache, target, name,
+                (zarray) {values.size, args});
             break;
         }
 
         case NODE_closure: {
-            result = exnoBuildClosure(info->value, frame);
+            result = exnoBuildClosure(info->value, frame, info->varsSize);
             break;
         }
 
         case NODE_fetch: {
-            zvalue target = execute(info->target, frame, EX_value);
+            if (info->unboxed) {
+                result = frameGet(frame, info->depth, info->slot);
+            } else {
+                zvalue target = execute(info->target, frame, EX_value);
+                result = cm_fetch(target);
+            }
 
-            result = cm_fetch(target);
             break;
         }
 
@@ -158,16 +184,33 @@ static zvalue execute(zvalue node, Frame *frame, zexecOperation op) {
             }
 
             zvalue value = execute(info->value, frame, EX_maybe);
-            zvalue boxInstance = (value == NULL)
-                ? METH_CALL(info->box, new)
-                : METH_CALL(info->box, new, value);
 
-            frameDef(frame, info->name, boxInstance);
+            if (info->unboxed) {
+                frameDef(frame, info->slot, value);
+            } else {
+                zvalue boxInstance = (value == NULL)
+                    ? METH_CALL(info->box, new)
+                    : METH_CALL(info->box, new, value);
+
+                frameDef(frame, info->slot, boxInstance);
+            }
+
             return NULL;
         }
 
         case NODE_varRef: {
-            result = frameGet(frame, info->name);
+            if (info->depth < 0) {
+                zvalue nameStr = cm_castFrom(CLS_String, info->name);
+                die("Variable not defined: %s", cm_debugString(nameStr));
+            }
+
+            result = frameGet(frame, info->depth, info->slot);
+
+            if (info->unboxed) {
+                // The box itself is needed. Make one.
+                result = cm_newBox(Result, result);
+            }
+
             break;
         }
 
@@ -199,84 +242,11 @@ static zvalue execute(zvalue node, Frame *frame, zexecOperation op) {
 }
 
 
-//
-// Module Definitions
-//
-
-// Documented in header.
-void exnoConvert(zvalue *orig) {
-    if (*orig == NULL) {
-        // Nothing to do.
-    } else if (typeAccepts(CLS_Record, *orig)) {
-        *orig = cm_new(ExecNode, *orig);
-    } else {
-        // Assumed to be a list.
-        zarray arr = zarrayFromList(*orig);
-        zvalue result[arr.size];
-
-        for (zint i = 0; i < arr.size; i++) {
-            result[i] = arr.elems[i];
-            exnoConvert(&result[i]);
-        }
-
-        *orig = listFromZarray((zarray) {arr.size, result});
-    }
-}
-
-// Documented in header.
-zvalue exnoExecute(zvalue node, Frame *frame) {
-    assertHasClass(node, CLS_ExecNode);
-    return execute(node, frame, EX_maybe);
-}
-
-// Documented in header.
-void exnoExecuteStatements(zarray statements, Frame *frame) {
-    for (zint i = 0; i < statements.size; i++) {
-        execute(statements.elems[i], frame, EX_statement);
-    }
-}
-
-// Documented in header.
-zvalue exnoVarDefName(zvalue node) {
-    ExecNodeInfo *info = getInfo(node);
-
-    return (info->type == NODE_varDef)
-        ? info->name
-        : NULL;
-}
-
-
-//
-// Exported Definitions
-//
-
-// Documented in header.
-zvalue langEval0(zvalue env, zvalue node) {
-    zint size = get_size(env);
-    zmapping mappings[size];
-
-    arrayFromSymtab(mappings, env);
-    for (zint i = 0; i < size; i++) {
-        mappings[i].value = cm_new(Result, mappings[i].value);
-    }
-    env = symtabFromZassoc((zassoc) {size, mappings});
-
-    Frame frame;
-    frameInit(&frame, NULL, NULL, env);
-
-    exnoConvert(&node);
-    return exnoExecute(node, &frame);
-}
-
-
-//
-// Class Definition
-//
-
 /**
- * Constructs an instance from the given (per spec) executable tree node.
+ * Constructs an instance from the given (per spec) executable tree node,
+ * in the given scope.
  */
-CMETH_IMPL_1(ExecNode, new, orig) {
+static zvalue convertNode(zvalue orig, Scope *scope) {
     znodeType type = nodeRecType(orig);
     zvalue result = datAllocValue(CLS_ExecNode, sizeof(ExecNodeInfo));
     ExecNodeInfo *info = getInfo(result);
@@ -293,11 +263,12 @@ CMETH_IMPL_1(ExecNode, new, orig) {
                 die("Invalid `apply` or `call` node.");
             }
 
-            exnoConvert(&info->target);
-            exnoConvert(&info->name);
-            exnoConvert(&info->values);
+            exnoConvert(&info->target, scope);
+            exnoConvert(&info->name, scope);
+            exnoConvert(&info->values, scope);
 
             if (type == NODE_call) {
+                info->values = listFlatten(info->values);
                 info->valuesArr = zarrayFromList(info->values);
             }
 
@@ -305,7 +276,8 @@ CMETH_IMPL_1(ExecNode, new, orig) {
         }
 
         case NODE_closure: {
-            info->value = cm_new(ClosureNode, orig);
+            info->varsSize = scope->size;
+            info->value = exnoConvertClosure(orig, scope);
             break;
         }
 
@@ -314,7 +286,31 @@ CMETH_IMPL_1(ExecNode, new, orig) {
                 die("Invalid `fetch` node.");
             }
 
-            exnoConvert(&info->target);
+            exnoConvert(&info->target, scope);
+
+            if (classOf(info->target) != CLS_ExecNode) {
+                break;
+            }
+
+            ExecNodeInfo *targetInfo = getInfo(info->target);
+
+            if ((targetInfo->type == NODE_varRef) && targetInfo->unboxed) {
+                // Fetch directly from the frame, without making a box.
+                info->unboxed = true;
+                info->depth = targetInfo->depth;
+                info->slot = targetInfo->slot;
+            } else if ((targetInfo->type == NODE_literal)
+                    && (classOf(targetInfo->value) == CLS_Result)) {
+                // `Result`s never change, so this can be a literal too.
+                // This is what references to globals look like.
+                zvalue value = cm_fetch(targetInfo->value);
+
+                if (value != NULL) {
+                    info->type = NODE_literal;
+                    info->value = value;
+                }
+            }
+
             break;
         }
 
@@ -322,7 +318,8 @@ CMETH_IMPL_1(ExecNode, new, orig) {
         case NODE_importModuleSelection:
         case NODE_importResource: {
             info->values = makeDynamicImport(orig);
-            exnoConvert(&info->values);
+            exnoConvert(&info->values, scope);
+            info->values = listFlatten(info->values);
             info->valuesArr = zarrayFromList(info->values);
             break;
         }
@@ -335,7 +332,7 @@ CMETH_IMPL_1(ExecNode, new, orig) {
             }
 
             if (type != NODE_literal) {
-                exnoConvert(&info->value);
+                exnoConvert(&info->value, scope);
             }
 
             break;
@@ -348,8 +345,8 @@ CMETH_IMPL_1(ExecNode, new, orig) {
                 die("Invalid `store` node.");
             }
 
-            exnoConvert(&info->target);
-            exnoConvert(&info->value);
+            exnoConvert(&info->target, scope);
+            exnoConvert(&info->value, scope);
             break;
         }
 
@@ -371,7 +368,11 @@ CMETH_IMPL_1(ExecNode, new, orig) {
                 }
             }
 
-            exnoConvert(&info->value);
+            // The variable only comes into scope after its value has been
+            // converted.
+            exnoConvert(&info->value, scope);
+            info->unboxed = (info->box == CLS_Result);
+            info->slot = scopeDef(scope, info->name, info->unboxed);
             break;
         }
 
@@ -379,6 +380,17 @@ CMETH_IMPL_1(ExecNode, new, orig) {
             if (!recGet1(orig, SYM(name), &info->name)) {
                 die("Invalid `varRef` node.");
             }
+
+            zvalue box = scopeFind(scope, info->name,
+                &info->depth, &info->slot, &info->unboxed);
+
+            if (box != NULL) {
+                // It's a global, and the environment is fixed by the time
+                // code is converted, so the box itself can be the result.
+                info->type = NODE_literal;
+                info->value = box;
+            }
+
             break;
         }
 
@@ -392,9 +404,364 @@ CMETH_IMPL_1(ExecNode, new, orig) {
         }
     }
 
+    // Conversion of the sub-nodes can allocate, so `result` may have
+    // survived a gc by this point.
+    datWriteBarrier(result);
     return result;
 }
 
+/**
+ * Emits code to execute the given node using the tree walker. This is used
+ * for the cases that just report an error, so as to let `execute()` do the
+ * reporting.
+ */
+static void compileFallback(zvalue node, BytecodeBuilder *builder,
+        zexecOperation op) {
+    bcbEmit(builder, BC_fallback, (op == EX_statement) ? 0 : 1);
+    bcbArg(builder, bcbConst(builder, node));
+    bcbArg(builder, op);
+}
+
+/**
+ * Emits code to push the contents of the given variable slot.
+ */
+static void compileVarRef(BytecodeBuilder *builder, zint depth, zint slot) {
+    if (depth == 0) {
+        bcbEmit(builder, BC_varRef0, 1);
+        bcbArg(builder, slot);
+    } else {
+        bcbEmit(builder, BC_varRef, 1);
+        bcbArg(builder, depth);
+        bcbArg(builder, slot);
+    }
+}
+
+/**
+ * Helper for `exnoCompileYield()` and `exnoExecuteYield()`, which returns
+ * the `call` node which the given `yield` node consists of, or `NULL` if
+ * it isn't just a call. On success, `*mustBeValue` indicates whether the
+ * call has to return a value (that is, whether it wasn't `maybe`-wrapped).
+ */
+static zvalue tailCallNode(zvalue node, bool *mustBeValue) {
+    ExecNodeInfo *info = getInfo(node);
+
+    *mustBeValue = (info->type != NODE_maybe);
+
+    if (!*mustBeValue) {
+        node = info->value;
+        info = getInfo(node);
+    }
+
+    return (info->type == NODE_call) ? node : NULL;
+}
+
+
+//
+// Module Definitions
+//
+
+// Documented in header.
+void exnoCompile(zvalue node, BytecodeBuilder *builder, zexecOperation op) {
+    ExecNodeInfo *info = getInfo(node);
+    bool mayBeVoid = false;  // Whether the result (if any) might be void.
+
+    switch (info->type) {
+        case NODE_apply: {
+            exnoCompile(info->target, builder, EX_value);
+            exnoCompile(info->name, builder, EX_value);
+            exnoCompile(info->values, builder, EX_maybe);
+            bcbEmit(builder, BC_apply, -2);
+            mayBeVoid = true;
+            break;
+        }
+
+        case NODE_call: {
+            zarray values = info->valuesArr;
+
+            exnoCompile(info->target, builder, EX_value);
+            exnoCompile(info->name, builder, EX_value);
+
+            for (zint i = 0; i < values.size; i++) {
+                exnoCompile(values.elems[i], builder, EX_value);
+            }
+
+            bcbEmit(builder, BC_call, -(values.size + 1));
+            bcbArg(builder, values.size);
+            bcbArg(builder, bcbCache(builder));
+            mayBeVoid = true;
+            break;
+        }
+
+        case NODE_closure: {
+            bcbEmit(builder, BC_closure, 1);
+            bcbArg(builder, bcbConst(builder, info->value));
+            bcbArg(builder, info->varsSize);
+            break;
+        }
+
+        case NODE_fetch: {
+            if (info->unboxed) {
+                compileVarRef(builder, info->depth, info->slot);
+            } else {
+                exnoCompile(info->target, builder, EX_value);
+                bcbEmit(builder, BC_fetch, 0);
+            }
+
+            mayBeVoid = true;
+            break;
+        }
+
+        case NODE_importModule:
+        case NODE_importModuleSelection:
+        case NODE_importResource: {
+            if (op != EX_statement) {
+                compileFallback(node, builder, op);
+                return;
+            }
+
+            for (zint i = 0; i < info->valuesArr.size; i++) {
+                exnoCompile(info->valuesArr.elems[i], builder, EX_statement);
+            }
+
+            return;
+        }
+
+        case NODE_literal: {
+            if (op == EX_statement) {
+                return;
+            }
+
+            bcbEmit(builder, BC_literal, 1);
+            bcbArg(builder, bcbConst(builder, info->value));
+            break;
+        }
+
+        case NODE_maybe: {
+            if (op != EX_maybe) {
+                compileFallback(node, builder, op);
+                return;
+            }
+
+            // No void check, same as in `execute()`.
+            exnoCompile(info->value, builder, EX_voidOk);
+            return;
+        }
+
+        case NODE_noYield: {
+            exnoCompile(info->value, builder, EX_voidOk);
+            bcbEmit(builder, BC_noYield, -1);
+
+            // `BC_noYield` never returns, but as far as the code that
+            // follows is concerned, this node yields a value.
+            if (op != EX_statement) {
+                bcbEmit(builder, BC_void, 1);
+            }
+
+            return;
+        }
+
+        case NODE_store: {
+            exnoCompile(info->target, builder, EX_value);
+            exnoCompile(info->value, builder, EX_maybe);
+            bcbEmit(builder, BC_store, -1);
+            mayBeVoid = true;
+            break;
+        }
+
+        case NODE_varDef: {
+            if (op != EX_statement) {
+                compileFallback(node, builder, op);
+                return;
+            }
+
+            exnoCompile(info->value, builder, EX_maybe);
+
+            if (info->unboxed) {
+                bcbEmit(builder, BC_varDefUnboxed, -1);
+                bcbArg(builder, info->slot);
+            } else {
+                bcbEmit(builder, BC_varDef, -1);
+                bcbArg(builder, info->slot);
+                bcbArg(builder, bcbConst(builder, info->box));
+            }
+
+            return;
+        }
+
+        case NODE_varRef: {
+            if (info->depth < 0) {
+                // Undefined variable.
+                compileFallback(node, builder, op);
+                return;
+            } else if (op == EX_statement) {
+                return;
+            }
+
+            compileVarRef(builder, info->depth, info->slot);
+
+            if (info->unboxed) {
+                // The box itself is needed. Make one.
+                bcbEmit(builder, BC_box, 0);
+            }
+
+            break;
+        }
+
+        case NODE_void: {
+            if (op != EX_maybe) {
+                compileFallback(node, builder, op);
+                return;
+            }
+
+            bcbEmit(builder, BC_void, 1);
+            return;
+        }
+
+        default: {
+            die("Invalid type (shouldn't happen): %d", info->type);
+        }
+    }
+
+    // This mirrors the check at the end of `execute()`.
+    switch (op) {
+        case EX_statement: { bcbEmit(builder, BC_pop, -1); break; }
+        case EX_voidOk:    { break; }
+        default: {
+            if (mayBeVoid) {
+                bcbEmit(builder, BC_nonVoid, 0);
+            }
+            break;
+        }
+    }
+}
+
+// Documented in header.
+void exnoCompileYield(zvalue node, BytecodeBuilder *builder) {
+    bool mustBeValue;
+    zvalue call = tailCallNode(node, &mustBeValue);
+
+    if (call == NULL) {
+        exnoCompile(node, builder, EX_maybe);
+        return;
+    }
+
+    ExecNodeInfo *info = getInfo(call);
+    zarray values = info->valuesArr;
+
+    exnoCompile(info->target, builder, EX_value);
+    exnoCompile(info->name, builder, EX_value);
+
+    for (zint i = 0; i < values.size; i++) {
+        exnoCompile(values.elems[i], builder, EX_value);
+    }
+
+    // The stack effect is as if the call left its result on the stack,
+    // so that the code following it (which never gets run) still adds up.
+    bcbEmit(builder, BC_tailCall, -(values.size + 1));
+    bcbArg(builder, values.size);
+    bcbArg(builder, mustBeValue);
+}
+
+// Documented in header.
+void exnoConvert(zvalue *orig, Scope *scope) {
+    if (*orig == NULL) {
+        // Nothing to do.
+    } else if (typeAccepts(CLS_Record, *orig)) {
+        *orig = convertNode(*orig, scope);
+    } else {
+        // Assumed to be a list. Only the list being built needs to be kept
+        // on the frame from one element to the next, so that very long
+        // lists (e.g. the statements of a large file) can be converted.
+        zarray arr = zarrayFromList(*orig);
+        zstackPointer save = datFrameStart();
+        zvalue result = EMPTY_LIST;
+
+        for (zint i = 0; i < arr.size; i++) {
+            zvalue one = arr.elems[i];
+            exnoConvert(&one, scope);
+            result = listAppend(result, one);
+            datFrameReturn(save, result);
+        }
+
+        *orig = result;
+    }
+}
+
+// Documented in header.
+zvalue exnoExecute(zvalue node, Frame *frame) {
+    assertHasClass(node, CLS_ExecNode);
+    return execute(node, frame, EX_maybe);
+}
+
+// Documented in header.
+zvalue exnoExecuteOp(zvalue node, Frame *frame, zexecOperation op) {
+    return execute(node, frame, op);
+}
+
+// Documented in header.
+void exnoExecuteStatements(zarray statements, Frame *frame) {
+    for (zint i = 0; i < statements.size; i++) {
+        execute(statements.elems[i], frame, EX_statement);
+    }
+}
+
+// Documented in header.
+zvalue exnoExecuteYield(zvalue node, Frame *frame) {
+    bool mustBeValue;
+    zvalue call = tailCallNode(node, &mustBeValue);
+
+    if (call == NULL) {
+        return execute(node, frame, EX_maybe);
+    }
+
+    ExecNodeInfo *info = getInfo(call);
+    zvalue target = execute(info->target, frame, EX_value);
+    zvalue name = execute(info->name, frame, EX_value);
+    zarray values = info->valuesArr;
+
+    // Evaluate each argument expression.
+    zvalue args[values.size];
+    for (zint i = 0; i < values.size; i++) {
+        args[i] = execute(values.elems[i], frame, EX_value);
+    }
+
+    return methTailCall(target, name, (zarray) {values.size, args},
+        mustBeValue);
+}
+
+
+//
+// Exported Definitions
+//
+
+// Documented in header.
+zvalue langEval0(zvalue env, zvalue node) {
+    zint size = get_size(env);
+    zmapping mappings[size];
+
+    arrayFromSymtab(mappings, env);
+    for (zint i = 0; i < size; i++) {
+        mappings[i].value = cm_new(Result, mappings[i].value);
+    }
+    env = symtabFromZassoc((zassoc) {size, mappings});
+
+    Scope scope;
+    scopeInit(&scope, NULL, env);
+    exnoConvert(&node, &scope);
+
+    Frame frame;
+    zvalue vars[scope.size];
+    frameInit(&frame, NULL, NULL, vars, scope.size);
+    scopeFree(&scope);
+
+    return exnoExecute(node, &frame);
+}
+
+
+//
+// Class Definition
+//
+
 // Documented in spec.
 METH_IMPL_0(ExecNode, debugSymbol) {
     return getInfo(ths)->name;
@@ -420,11 +787,12 @@ MOD_INIT(ExecNode) {
     MOD_USE(ClosureNode);
 
     CLS_ExecNode = makeCoreClass(SYM(ExecNode), CLS_Core,
-        METH_TABLE(
-            CMETH_BIND(ExecNode, new)),
+        NULL,
         METH_TABLE(
             METH_BIND(ExecNode, debugSymbol),
             METH_BIND(ExecNode, gcMark)));
+
+    classSetThreadSafeGcMark(CLS_ExecNode);
 }
 
 // Documented in header.
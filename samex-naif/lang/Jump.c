@@ -58,7 +58,7 @@ METH_IMPL_rest(Jump, call, args) {
     }
 
     info->valid = false;
-    siglongjmp(info->env, 1);
+    _longjmp(info->env, 1);
 }
 
 // Documented in spec.
@@ -90,6 +90,8 @@ MOD_INIT(Jump) {
             METH_BIND(Jump, call),
             METH_BIND(Jump, debugString),
             METH_BIND(Jump, gcMark)));
+
+    classSetThreadSafeGcMark(CLS_Jump);
 }
 
 // Documented in header.
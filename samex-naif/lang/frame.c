@@ -6,10 +6,6 @@
 // Execution frames
 //
 
-#include "type/Box.h"
-#include "type/String.h"
-#include "type/Symbol.h"
-#include "type/SymbolTable.h"
 #include "util.h"
 
 #include "impl.h"
@@ -21,44 +17,51 @@
 
 // Documented in header.
 void frameInit(Frame *frame, Frame *parentFrame, zvalue parentClosure,
-        zvalue vars) {
+        zvalue *vars, zint varsSize) {
     if ((parentFrame != NULL) && !parentFrame->onHeap) {
         die("Stack-allocated `parentFrame`.");
     }
 
+    for (zint i = 0; i < varsSize; i++) {
+        vars[i] = NULL;
+    }
+
     frame->parentFrame = parentFrame;
     frame->parentClosure = parentClosure;
     frame->vars = vars;
+    frame->varsSize = varsSize;
     frame->onHeap = false;
 }
 
 // Documented in header.
 void frameMark(Frame *frame) {
-    datMark(frame->vars);
+    for (zint i = 0; i < frame->varsSize; i++) {
+        datMark(frame->vars[i]);
+    }
+
     datMark(frame->parentClosure);  // This will mark `parentFrame`.
 }
 
 // Documented in header.
-void frameDef(Frame *frame, zvalue name, zvalue box) {
-    frame->vars = symtabCatMapping(frame->vars, (zmapping) {name, box});
+void frameDef(Frame *frame, zint slot, zvalue box) {
+    frame->vars[slot] = box;
 }
 
 // Documented in header.
-zvalue frameGet(Frame *frame, zvalue name) {
-    for (/*frame*/; frame != NULL; frame = frame->parentFrame) {
-        zvalue result = symtabGet(frame->vars, name);
-
-        if (result != NULL) {
-            return result;
-        }
+zvalue frameGet(Frame *frame, zint depth, zint slot) {
+    for (/*depth*/; depth > 0; depth--) {
+        frame = frame->parentFrame;
     }
 
-    zvalue nameStr = cm_castFrom(CLS_String, name);
-    die("Variable not defined: %s", cm_debugString(nameStr));
+    return frame->vars[slot];
 }
 
 // Documented in header.
-void frameSnap(Frame *target, Frame *source) {
+void frameSnap(Frame *target, Frame *source, zvalue *vars, zint varsSize) {
+    utilCpy(zvalue, vars, source->vars, varsSize);
+
     *target = *source;
+    target->vars = vars;
+    target->varsSize = varsSize;
     target->onHeap = true;
 }
@@ -20,6 +20,12 @@
 
 /** Implementation limits. */
 enum {
+    /**
+     * Amount of C stack, in bytes, to keep in reserve. Calling a closure
+     * when less than this is left is reported as a stack overflow.
+     */
+    LANG_C_STACK_HEADROOM = 512 * 1024,
+
     /** Maximum number of formal arguments to a function. */
     LANG_MAX_FORMALS = 20,
 
@@ -30,12 +36,136 @@ enum {
     LANG_MAX_STRING_CHARS = 200,
 
     /**
-     * Maximum number of tokens in a given parse (which is the maximum
-     * number of characters for a tokenizer).
+     * Number of tokens the tokenizer collects at a time (on the C stack)
+     * before adding them to the list of all tokens.
      */
-    LANG_MAX_TOKENS = 100000
+    LANG_TOKEN_CHUNK_SIZE = 1000,
+
+    /** Initial size of the code and constant arrays of bytecode. */
+    LANG_BYTECODE_MIN_SIZE = 32,
+
+    /** Initial number of variable names a `Scope` has room for. */
+    LANG_SCOPE_MIN_SIZE = 16
 };
 
+/**
+ * Identifies the variant of execution.
+ */
+typedef enum {
+    EX_statement,  // Yield ignored; also allows `varDef` and `import*`.
+    EX_value,      // Must yield a value (not void).
+    EX_maybe,      // This allows both `maybe` and `void`.
+    EX_voidOk      // Allowed to yield void.
+} zexecOperation;
+
+/**
+ * Bytecode operations. Each is followed in the code by the listed
+ * arguments (if any). Stack effects are listed as `[before] -> [after]`,
+ * with the top of the stack at the right.
+ */
+typedef enum {
+    /** `[target name values] -> [result]`. Result may be void. */
+    BC_apply,
+
+    /** `[value] -> [box]`. Makes a `Result` of an unboxed variable. */
+    BC_box,
+
+    /**
+     * `argCount cacheIndex`: `[target name args*] -> [result]`. Result may
+     * be void.
+     */
+    BC_call,
+
+    /** `constIndex varsSize`: `[] -> [closure]`. */
+    BC_closure,
+
+    /**
+     * `constIndex op`: `[] -> [result]` (or `[] -> []` for
+     * `EX_statement`). Executes the `ExecNode` constant using the tree
+     * walker, with the given `zexecOperation`. This is used for the
+     * cases that are really just there to report errors.
+     */
+    BC_fallback,
+
+    /** `[box] -> [result]`. Result may be void. */
+    BC_fetch,
+
+    /** `constIndex`: `[] -> [value]`. */
+    BC_literal,
+
+    /** `[value] -> (never returns)`. */
+    BC_noYield,
+
+    /** `[value] -> [value]`. Fails if the value is void. */
+    BC_nonVoid,
+
+    /** `[value] -> []`. */
+    BC_pop,
+
+    /** `[box value] -> [result]`. Result may be void. */
+    BC_store,
+
+    /**
+     * `argCount mustBeValue`: `[target name arg*] -> (returns)`. Sets up
+     * the call as a tail call (see `methTailCall()`), and returns.
+     */
+    BC_tailCall,
+
+    /** `slot constIndex`: `[value] -> []`. The constant is the box class. */
+    BC_varDef,
+
+    /** `slot`: `[value] -> []`. Defines an unboxed variable. */
+    BC_varDefUnboxed,
+
+    /**
+     * `depth slot`: `[] -> [contents]`. The contents are a box, or the
+     * value of an unboxed variable (which may be void).
+     */
+    BC_varRef,
+
+    /** `slot`: `[] -> [contents]`. Same as `BC_varRef` with depth `0`. */
+    BC_varRef0,
+
+    /** `[] -> [void]`. */
+    BC_void,
+
+    /** `[value] -> (returns value)`. */
+    BC_yield
+} zbytecodeOp;
+
+/**
+ * Bytecode under construction. The stack size is tracked as code is
+ * emitted, so that the interpreter knows how much room to reserve.
+ */
+typedef struct {
+    /** Code emitted so far. */
+    zint *code;
+
+    /** Number of elements of `code` in use. */
+    zint codeSize;
+
+    /** Allocated size of `code`. */
+    zint codeMax;
+
+    /** Constants referred to by the code. */
+    zvalue *consts;
+
+    /** Number of elements of `consts` in use. */
+    zint constsSize;
+
+    /** Allocated size of `consts`. */
+    zint constsMax;
+
+    /** Number of inline method caches needed by the code. */
+    zint cachesSize;
+
+    /** Stack size at the current point in the code. */
+    zint stackSize;
+
+    /** Maximum stack size at any point in the code. */
+    zint maxStack;
+} BytecodeBuilder;
+
 /**
  * Active execution frame. These are passed around during evaluation
  * as code executes, and can become referenced by closures that are
@@ -48,13 +178,65 @@ typedef struct Frame {
     /** Parent frame. May be `NULL`. */
     struct Frame *parentFrame;
 
-    /** Variables defined in this frame, as a table from names to values. */
-    zvalue vars;
+    /**
+     * Variables defined in this frame, indexed by slot. Slots are assigned
+     * when the code is converted (see `Scope`, below). Each element is
+     * either a box or, for an unboxed variable, the (possibly void) value
+     * itself. Variables that would be bound to a `Result` (formals, the
+     * `yieldDef`, and non-promise `def`s) are unboxed, with boxes only made
+     * for them if code needs one.
+     */
+    zvalue *vars;
+
+    /** Number of elements in `vars`. */
+    zint varsSize;
 
     /** Is this frame on the heap? Used for validation/asserts. */
     bool onHeap;
 } Frame;
 
+/**
+ * Lexical scope, used while converting code, so that variable references
+ * can be resolved to frame slots ahead of execution. There is one scope
+ * per closure, corresponding to the frames that get created when calling
+ * it. The outermost scope corresponds to the environment passed to
+ * `langEval0()`.
+ */
+typedef struct Scope {
+    /** Enclosing scope. `NULL` for the outermost scope. */
+    struct Scope *parent;
+
+    /**
+     * Global environment, as a table from names to boxes. Only non-`NULL`
+     * for the outermost scope.
+     */
+    zvalue env;
+
+    /** Names of the variables defined so far, indexed by slot. */
+    zvalue *names;
+
+    /**
+     * Which of the variables defined so far are unboxed, indexed by slot.
+     * See `Frame.vars`.
+     */
+    bool *unboxed;
+
+    /** Number of variables defined so far. */
+    zint size;
+
+    /** Slot of the closure's `yieldDef`, or `-1` if it doesn't have one. */
+    zint yieldDefSlot;
+
+    /** Whether there have been any references to the `yieldDef`. */
+    bool yieldDefUsed;
+
+    /** Allocated size of `names`. */
+    zint max;
+} Scope;
+
+/** Type for compiled bytecode. */
+extern zvalue CLS_Bytecode;
+
 /** Type for closure functions. */
 extern zvalue CLS_Closure;
 
@@ -64,12 +246,59 @@ extern zvalue CLS_ClosureNode;
 /** Type for executable nodes. */
 extern zvalue CLS_ExecNode;
 
+/**
+ * Adds the given argument to the code being built.
+ */
+void bcbArg(BytecodeBuilder *builder, zint arg);
+
+/**
+ * Allocates an inline method cache for the code being built, returning its
+ * index.
+ */
+zint bcbCache(BytecodeBuilder *builder);
+
+/**
+ * Adds the given constant to the code being built, returning its index.
+ */
+zint bcbConst(BytecodeBuilder *builder, zvalue value);
+
+/**
+ * Adds the given operation to the code being built, which changes the
+ * size of the stack by `stackDelta`. Any arguments to the operation must be
+ * added with `bcbArg()`.
+ */
+void bcbEmit(BytecodeBuilder *builder, zbytecodeOp op, zint stackDelta);
+
+/**
+ * Finishes the code being built, returning a `Bytecode` instance. This
+ * frees the storage used by the builder.
+ */
+zvalue bcbFinish(BytecodeBuilder *builder);
+
+/**
+ * Initializes the given builder.
+ */
+void bcbInit(BytecodeBuilder *builder);
+
+/**
+ * Whether to run closures using the bytecode interpreter (as opposed to
+ * the tree walker). Set from the environment variable `SAMEX_INTERPRETER`.
+ */
+extern bool bytecodeEnabled;
+
+/**
+ * Runs the given `Bytecode` in the given frame, returning the result of
+ * its `BC_yield` (or, for a `BC_tailCall`, of `methTailCall()`).
+ */
+zvalue bytecodeExecute(zvalue bytecode, Frame *frame);
+
 /**
  * Executes a translated `closure` node, which means that a closure is to be
  * constructed. This takes a `ClosureNode` (not an `ExecNode`) and returns a
- * `Closure` instance.
+ * `Closure` instance. Only the first `varsSize` variables of `frame` are
+ * visible to the closure, and so only those are captured.
  */
-zvalue exnoBuildClosure(zvalue node, Frame *frame);
+zvalue exnoBuildClosure(zvalue node, Frame *frame, zint varsSize);
 
 /**
  * Calls a closure, using the given `node` to drive argument binding and
@@ -81,13 +310,36 @@ zvalue exnoBuildClosure(zvalue node, Frame *frame);
 zvalue exnoCallClosure(zvalue node, Frame *parentFrame, zvalue parentClosure,
         zarray args);
 
+/**
+ * Emits code into the given builder, which executes the given
+ * `ExecNode` with the given variant of execution. When `op` is
+ * `EX_statement`, the code leaves nothing on the stack; otherwise it
+ * leaves the (possibly void) result.
+ */
+void exnoCompile(zvalue node, BytecodeBuilder *builder, zexecOperation op);
+
+/**
+ * Emits code into the given builder, which executes the given `ExecNode`
+ * as the `yield` of a closure, leaving the (possibly void) result on the
+ * stack. If the node is a method call, it is instead emitted as a tail
+ * call, which returns directly.
+ */
+void exnoCompileYield(zvalue node, BytecodeBuilder *builder);
+
+/**
+ * Converts a `closure` node into a `ClosureNode`, in the given enclosing
+ * scope.
+ */
+zvalue exnoConvertClosure(zvalue orig, Scope *scope);
+
 /**
  * Converts an `expression` node or list (per se) of same. This converts
  * nodes into instances of `ExecNode`, and stores a reference to the
- * replacement via the given pointer. As a convenience, if `*orig` is `NULL`,]
- * this function does nothing.
+ * replacement via the given pointer. Variable references and definitions
+ * are resolved against (and, for the latter, added to) the given `scope`.
+ * As a convenience, if `*orig` is `NULL`, this function does nothing.
  */
-void exnoConvert(zvalue *orig);
+void exnoConvert(zvalue *orig, Scope *scope);
 
 /**
  * Executes a translated `expression` node, in particular an instance of
@@ -95,6 +347,12 @@ void exnoConvert(zvalue *orig);
  */
 zvalue exnoExecute(zvalue node, Frame *frame);
 
+/**
+ * Executes a translated `expression` node with the given variant of
+ * execution. Can return `NULL`.
+ */
+zvalue exnoExecuteOp(zvalue node, Frame *frame, zexecOperation op);
+
 /**
  * Executes a `zarray` of translated `expression` nodes, treating them as
  * statements. (E.g., it allows variable definitions and doesn't care if they
@@ -103,17 +361,21 @@ zvalue exnoExecute(zvalue node, Frame *frame);
 void exnoExecuteStatements(zarray statements, Frame *frame);
 
 /**
- * Given an `ExecNode`, returns the name of the variable it defines, if any.
- * This returns `NULL` for everything but converted `varDef` nodes.
+ * Executes a translated `expression` node as the `yield` of a closure.
+ * This is like `exnoExecute()`, except that if the node is a method call,
+ * it is set up as a tail call (see `methTailCall()`). As such, the result
+ * of this function must be returned directly from the closure's `call`.
  */
-zvalue exnoVarDefName(zvalue node);
+zvalue exnoExecuteYield(zvalue node, Frame *frame);
 
 /**
  * Initializes the given frame. The `frame` is assumed to live on the
- * C stack. The `parentFrame` if non-`NULL` must live on the heap.
+ * C stack. The `parentFrame` if non-`NULL` must live on the heap. `vars`
+ * is the (also stack-allocated) array of variable slots, all of which
+ * are initialized to `NULL`.
  */
 void frameInit(Frame *frame, Frame *parentFrame, zvalue parentClosure,
-    zvalue vars);
+    zvalue *vars, zint varsSize);
 
 /**
  * Does gc value marking.
@@ -121,20 +383,51 @@ void frameInit(Frame *frame, Frame *parentFrame, zvalue parentClosure,
 void frameMark(Frame *frame);
 
 /**
- * Defines a new variable to the given frame, binding it to the given box.
+ * Defines a new variable to the given frame, binding the given slot to the
+ * given box.
+ */
+void frameDef(Frame *frame, zint slot, zvalue box);
+
+/**
+ * Fetches the box associated with a variable, out of the given frame,
+ * which is `depth` frames up the chain from the given one.
+ */
+zvalue frameGet(Frame *frame, zint depth, zint slot);
+
+/**
+ * Snapshots the first `varsSize` variables of the given frame into the
+ * given target, using `vars` (which must have room for them) as storage.
+ * The `target` and `vars` are assumed to be part of a heap-allocated
+ * structure.
+ */
+void frameSnap(Frame *target, Frame *source, zvalue *vars, zint varsSize);
+
+/**
+ * Defines a new variable in the given scope, returning its slot. Fails
+ * with a terminal error if `name` is already defined in the scope.
+ * `unboxed` indicates whether the variable is unboxed (see `Frame.vars`).
+ */
+zint scopeDef(Scope *scope, zvalue name, bool unboxed);
+
+/**
+ * Resolves the given variable name in the given scope, storing the
+ * frame depth and slot of the variable, and whether it is unboxed, via the
+ * given pointers and returning `NULL`. If the variable is global, this
+ * instead returns its box. If the variable is not defined at all, `*depth`
+ * is set to `-1`.
  */
-void frameDef(Frame *frame, zvalue name, zvalue box);
+zvalue scopeFind(Scope *scope, zvalue name, zint *depth, zint *slot,
+    bool *unboxed);
 
 /**
- * Fetches the box associated with a variable, out of the given frame. Fails
- * with a terminal error if `name` is not found.
+ * Frees the storage used by the given scope (but not the scope itself).
  */
-zvalue frameGet(Frame *frame, zvalue name);
+void scopeFree(Scope *scope);
 
 /**
- * Snapshots the given frame into the given target. The `target` is assumed
- * to be part of a heap-allocated structure.
+ * Initializes the given scope, with the given enclosing scope and global
+ * environment (only one of which is non-`NULL`).
  */
-void frameSnap(Frame *target, Frame *source);
+void scopeInit(Scope *scope, Scope *parent, zvalue env);
 
 #endif
@@ -24,11 +24,11 @@
 
 /** State of parsing in-progress. */
 typedef struct {
-    /** token list being parsed. */
-    zvalue tokens;
-
-    /** Size of `tokens`. */
-    zint size;
+    /**
+     * Tokens being parsed. This shares storage with the token list, which
+     * the caller keeps alive.
+     */
+    zarray tokens;
 
     /** Current read position. */
     zint at;
@@ -38,7 +38,7 @@ typedef struct {
  * Is the parse state at EOF?
  */
 static bool isEof(ParseState *state) {
-    return (state->at >= state->size);
+    return (state->at >= state->tokens.size);
 }
 
 /**
@@ -49,7 +49,7 @@ static zvalue read(ParseState *state) {
         return NULL;
     }
 
-    zvalue result = cm_nth(state->tokens, state->at);
+    zvalue result = state->tokens.elems[state->at];
     state->at++;
 
     return result;
@@ -63,7 +63,7 @@ static zvalue readMatch(ParseState *state, zvalue name) {
         return NULL;
     }
 
-    zvalue result = cm_nth(state->tokens, state->at);
+    zvalue result = state->tokens.elems[state->at];
 
     if (recHasName(result, name)) {
         state->at++;
@@ -175,6 +175,7 @@ static zvalue parseOpt(parserFunction rule, ParseState *state) {
  * Parses `x*` for an arbitrary rule `x`. Returns a list of parsed `x` results.
  */
 static zvalue parseStar(parserFunction rule, ParseState *state) {
+    zstackPointer save = datFrameStart();
     zvalue result = EMPTY_LIST;
 
     for (;;) {
@@ -184,6 +185,7 @@ static zvalue parseStar(parserFunction rule, ParseState *state) {
         }
 
         result = listAppend(result, one);
+        datFrameReturn(save, result);
     }
 
     return result;
@@ -213,6 +215,7 @@ static zvalue parseDelimitedSequence(parserFunction rule, zvalue tokenType,
         return EMPTY_LIST;
     }
 
+    zstackPointer save = datFrameStart();
     zvalue result = cm_new_List(item);
 
     for (;;) {
@@ -222,17 +225,15 @@ static zvalue parseDelimitedSequence(parserFunction rule, zvalue tokenType,
             break;
         }
 
-        zstackPointer save = datFrameStart();
         item = rule(state);
 
-        datFrameReturn(save, item);
-
         if (item == NULL) {
             RESET();
             break;
         }
 
         result = listAppend(result, item);
+        datFrameReturn(save, result);
     }
 
     return result;
@@ -1258,6 +1259,10 @@ DEF_PARSE(closureBody) {
 
     PARSE(optSemicolons);
 
+    // Only the list being built needs to be kept on the frame from one
+    // iteration to the next.
+    zstackPointer save = datFrameStart();
+
     for (;;) {
         MARK();
 
@@ -1273,6 +1278,7 @@ DEF_PARSE(closureBody) {
 
         PARSE(optSemicolons);
         statements = listAppend(statements, statement);
+        datFrameReturn(save, statements);
     }
 
     zvalue statement = PARSE(statement);
@@ -1314,6 +1320,7 @@ DEF_PARSE(program) {
     // more awkward to do that at this layer; but the result should be the
     // same.
 
+    zstackPointer save = datFrameStart();
     zvalue statements = EMPTY_LIST;
     bool any = false;
     bool importOkay = true;
@@ -1341,6 +1348,7 @@ DEF_PARSE(program) {
         }
 
         statements = listAppend(statements, one);
+        datFrameReturn(save, statements);
         any = true;
     }
 
@@ -1365,7 +1373,7 @@ zvalue langParseExpression0(zvalue expression) {
         tokens = expression;
     }
 
-    ParseState state = {tokens, get_size(tokens), 0};
+    ParseState state = {zarrayFromList(tokens), 0};
     zvalue result = parse_expression(&state);
 
     if (!isEof(&state)) {
@@ -1386,7 +1394,7 @@ zvalue langParseProgram0(zvalue program) {
         tokens = program;
     }
 
-    ParseState state = {tokens, get_size(tokens), 0};
+    ParseState state = {zarrayFromList(tokens), 0};
     zvalue result = parse_program(&state);
 
     if (!isEof(&state)) {
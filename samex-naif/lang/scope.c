@@ -0,0 +1,121 @@
+// Copyright 2013-2014 the Samizdat Authors (Dan Bornstein et alia).
+// Licensed AS IS and WITHOUT WARRANTY under the Apache License,
+// Version 2.0. Details: <http://www.apache.org/licenses/LICENSE-2.0>
+
+//
+// Lexical scopes, for resolving variables to frame slots
+//
+
+#include "type/String.h"
+#include "type/SymbolTable.h"
+#include "util.h"
+
+#include "impl.h"
+
+
+//
+// Private Definitions
+//
+
+/**
+ * Finds the slot of the given name in the given scope, not looking at
+ * enclosing scopes. Returns `-1` if not found.
+ */
+static zint findSlot(Scope *scope, zvalue name) {
+    // Search from the most recent definition, since that's where references
+    // tend to be.
+    for (zint i = scope->size - 1; i >= 0; i--) {
+        if (scope->names[i] == name) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+
+//
+// Module Definitions
+//
+
+// Documented in header.
+zint scopeDef(Scope *scope, zvalue name, bool unboxed) {
+    if (findSlot(scope, name) >= 0) {
+        zvalue nameStr = cm_castFrom(CLS_String, name);
+        die("Duplicate variable name: %s", cm_debugString(nameStr));
+    }
+
+    if (scope->size == scope->max) {
+        zint newMax = (scope->max == 0) ? LANG_SCOPE_MIN_SIZE : scope->max * 2;
+        zvalue *newNames = utilAlloc(newMax * sizeof(zvalue));
+        bool *newUnboxed = utilAlloc(newMax * sizeof(bool));
+
+        utilCpy(zvalue, newNames, scope->names, scope->size);
+        utilCpy(bool, newUnboxed, scope->unboxed, scope->size);
+        utilFree(scope->names);
+        utilFree(scope->unboxed);
+        scope->names = newNames;
+        scope->unboxed = newUnboxed;
+        scope->max = newMax;
+    }
+
+    zint result = scope->size;
+    scope->names[result] = name;
+    scope->unboxed[result] = unboxed;
+    scope->size++;
+
+    return result;
+}
+
+// Documented in header.
+zvalue scopeFind(Scope *scope, zvalue name, zint *depth, zint *slot,
+        bool *unboxed) {
+    for (zint d = 0; scope != NULL; d++, scope = scope->parent) {
+        zint found = findSlot(scope, name);
+
+        if (found >= 0) {
+            *depth = d;
+            *slot = found;
+            *unboxed = scope->unboxed[found];
+
+            if (found == scope->yieldDefSlot) {
+                scope->yieldDefUsed = true;
+            }
+
+            return NULL;
+        } else if (scope->env != NULL) {
+            zvalue result = symtabGet(scope->env, name);
+
+            if (result != NULL) {
+                return result;
+            }
+        }
+    }
+
+    *depth = -1;
+    *slot = -1;
+    *unboxed = false;
+    return NULL;
+}
+
+// Documented in header.
+void scopeFree(Scope *scope) {
+    utilFree(scope->names);
+    utilFree(scope->unboxed);
+    scope->names = NULL;
+    scope->unboxed = NULL;
+    scope->size = 0;
+    scope->max = 0;
+}
+
+// Documented in header.
+void scopeInit(Scope *scope, Scope *parent, zvalue env) {
+    scope->parent = parent;
+    scope->env = env;
+    scope->names = NULL;
+    scope->unboxed = NULL;
+    scope->size = 0;
+    scope->max = 0;
+    scope->yieldDefSlot = -1;
+    scope->yieldDefUsed = false;
+}
@@ -44,7 +44,7 @@ static bool isEof(ParseState *state) {
  * Peeks at the next character.
  */
 static zint peek(ParseState *state) {
-    return isEof(state) ? (zint) -1 : state->str.chars[state->at];
+    return isEof(state) ? (zint) -1 : zstringNth(state->str, state->at);
 }
 
 /**
@@ -157,7 +157,7 @@ static zvalue tokenizeInt(ParseState *state) {
  */
 static zvalue tokenizeIdentifier(ParseState *state) {
     zchar chars[LANG_MAX_STRING_CHARS];
-    zstring s = {0, chars};
+    zstring s = zstringFromZchars(0, chars);
 
     for (;;) {
         zint ch = peek(state);
@@ -216,7 +216,7 @@ static zvalue tokenizeString(ParseState *state) {
     read(state);
 
     zchar chars[LANG_MAX_STRING_CHARS];
-    zstring s = {0, chars};
+    zstring s = zstringFromZchars(0, chars);
 
     for (;;) {
         zint ch = peek(state);
@@ -329,7 +329,7 @@ static zvalue tokenizeDirective(ParseState *state) {
     }
 
     zchar chars[LANG_MAX_STRING_CHARS];
-    zstring s = {0, chars};
+    zstring s = zstringFromZchars(0, chars);
 
     for (;;) {
         zint ch = read(state);
@@ -431,25 +431,30 @@ zvalue langLanguageOf0(zvalue string) {
 zvalue langTokenize0(zvalue string) {
     zstackPointer save = datFrameStart();
     ParseState state = {.str = zstringFromString(string), .at = 0};
+    zvalue result = EMPTY_LIST;
 
-    zvalue result[LANG_MAX_TOKENS];
+    zvalue chunk[LANG_TOKEN_CHUNK_SIZE];
     zint out = 0;
 
     for (;;) {
+        if (out == LANG_TOKEN_CHUNK_SIZE) {
+            // Add the full chunk to the result. After that, the result is
+            // the only thing that needs to be kept on the frame.
+            result = cm_cat(result, listFromZarray((zarray) {out, chunk}));
+            datFrameReturn(save, result);
+            out = 0;
+        }
+
         zvalue one = tokenizeAnyToken(&state);
         if (one == NULL) {
             break;
         } else if (!nodeRecTypeIs(one, NODE_directive)) {
-            if (out >= LANG_MAX_TOKENS) {
-                die("Too many tokens.");
-            }
-
-            result[out] = one;
+            chunk[out] = one;
             out++;
         }
     }
 
-    zvalue resultList = listFromZarray((zarray) {out, result});
-    datFrameReturn(save, resultList);
-    return resultList;
+    result = cm_cat(result, listFromZarray((zarray) {out, chunk}));
+    datFrameReturn(save, result);
+    return result;
 }
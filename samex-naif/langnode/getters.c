@@ -22,12 +22,12 @@ static zvalue splitAtChar(zvalue string, zvalue chString) {
 
     for (zint at = 0; at <= s.size; /*at*/) {
         zint endAt = at;
-        while ((endAt < s.size) && s.chars[endAt] != ch) {
+        while ((endAt < s.size) && (zstringNth(s, endAt) != ch)) {
             endAt++;
         }
 
         result[resultAt] =
-            stringFromZstring((zstring) {endAt - at, &s.chars[at]});
+            stringFromZstring(zstringSlice(s, at, endAt - at));
         resultAt++;
         at = endAt + 1;
     }
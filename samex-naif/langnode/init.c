@@ -15,7 +15,13 @@
 //
 
 // Documented in header.
-znodeType nodeSymbolMap[DAT_MAX_SYMBOLS];
+znodeType *nodeSymbolMap = NULL;
+
+// Documented in header.
+zint nodeSymbolMapSize = 0;
+
+// This provides the non-inline version of this function.
+extern znodeType nodeIndexType(zint index);
 
 // This provides the non-inline version of this function.
 extern znodeType nodeRecType(zvalue record);
@@ -31,7 +37,8 @@ MOD_INIT(langnode) {
     MOD_USE(cls);
     MOD_USE(lang_consts);
 
-    utilZero(nodeSymbolMap);
+    nodeSymbolMapSize = symbolIndexLimit();
+    nodeSymbolMap = utilAlloc(nodeSymbolMapSize * sizeof(znodeType));
 
     #define SYM_MAP(name) nodeSymbolMap[SYMIDX(name)] = NODE_##name;
 
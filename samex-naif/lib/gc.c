@@ -0,0 +1,142 @@
+// Copyright 2013-2014 the Samizdat Authors (Dan Bornstein et alia).
+// Licensed AS IS and WITHOUT WARRANTY under the Apache License,
+// Version 2.0. Details: <http://www.apache.org/licenses/LICENSE-2.0>
+
+#include "type/Bool.h"
+#include "type/Int.h"
+#include "type/List.h"
+#include "type/Symbol.h"
+#include "type/SymbolTable.h"
+
+#include "impl.h"
+
+
+//
+// Private Definitions
+//
+
+/**
+ * Makes a mapping from the given name (converted to a symbol) to the
+ * given int.
+ */
+static zmapping intMapping(const char *name, zint value) {
+    return (zmapping) {symbolFromUtf8(-1, name), intFromZint(value)};
+}
+
+/**
+ * Makes a `@{class, count, bytes}` symbol table from the given class stats.
+ * The `class` binding is omitted if the stats don't have a class.
+ */
+static zvalue symtabFromClassStats(DatClassStats *stats) {
+    zmapping mappings[] = {
+        intMapping("bytes", stats->bytes),
+        intMapping("count", stats->count),
+        {symbolFromUtf8(-1, "class"), stats->cls}
+    };
+
+    zint size = (stats->cls == NULL) ? 2 : 3;
+    return symtabFromZassoc((zassoc) {size, mappings});
+}
+
+/**
+ * Makes the `classes` and `freedClasses` bindings of the result of
+ * `Gc0_stats`, storing them into the given `result`. `classes` is a list
+ * and not a map, because same-named classes are unordered with respect to
+ * each other.
+ */
+static void classMappings(zmapping *result) {
+    zint size = datGetClassStats(0, NULL);
+    DatClassStats stats[size];
+    zvalue elems[size];
+    zint at = 0;
+
+    datGetClassStats(size, stats);
+
+    // The stats only refer to their classes weakly, so keep them from
+    // getting freed while building the result.
+    for (zint i = 0; i < size; i++) {
+        datFrameAdd(stats[i].cls);
+    }
+
+    zvalue freed = symtabFromClassStats(&(DatClassStats) {NULL, 0, 0});
+
+    for (zint i = 0; i < size; i++) {
+        zvalue one = symtabFromClassStats(&stats[i]);
+
+        if (stats[i].cls == NULL) {
+            freed = one;
+        } else {
+            elems[at] = one;
+            at++;
+        }
+    }
+
+    result[0] = (zmapping) {
+        symbolFromUtf8(-1, "classes"), listFromZarray((zarray) {at, elems})};
+    result[1] = (zmapping) {symbolFromUtf8(-1, "freedClasses"), freed};
+}
+
+/**
+ * Makes a list of `@{major, pauseUsec, liveBytes}` symbol tables from
+ * the recent gc cycles in the given stats.
+ */
+static zvalue listFromRecentCycles(DatGcStats *stats) {
+    zint size = stats->recentCount;
+    zvalue elems[size];
+
+    for (zint i = 0; i < size; i++) {
+        DatGcCycle *one = &stats->recentCycles[i];
+        zmapping mappings[] = {
+            intMapping("liveBytes", one->liveBytes),
+            {symbolFromUtf8(-1, "major"), boolFromZbool(one->major)},
+            intMapping("pauseUsec", one->pauseUsec)
+        };
+
+        elems[i] = symtabFromZassoc((zassoc) {3, mappings});
+    }
+
+    return listFromZarray((zarray) {size, elems});
+}
+
+
+//
+// Exported Definitions
+//
+
+// Documented in spec.
+FUN_IMPL_DECL(Gc0_gc) {
+    datGc();
+    return NULL;
+}
+
+// Documented in spec.
+FUN_IMPL_DECL(Gc0_stats) {
+    DatGcStats stats;
+    datGetGcStats(&stats);
+
+    zvalue histogram[DAT_GC_PAUSE_BUCKETS];
+    for (zint i = 0; i < DAT_GC_PAUSE_BUCKETS; i++) {
+        histogram[i] = intFromZint(stats.pauseHistogram[i]);
+    }
+
+    zmapping mappings[] = {
+        intMapping("allocBytes",          stats.allocBytes),
+        intMapping("allocCount",          stats.allocCount),
+        intMapping("frameStackHighWater", stats.frameStackHighWater),
+        intMapping("gcCount",             stats.gcCount),
+        intMapping("liveBytes",           stats.liveBytes),
+        intMapping("majorGcCount",        stats.majorGcCount),
+        intMapping("maxPauseUsec",        stats.maxPauseUsec),
+        {symbolFromUtf8(-1, "pauseHistogram"),
+            listFromZarray((zarray) {DAT_GC_PAUSE_BUCKETS, histogram})},
+        intMapping("peakLiveBytes",       stats.peakLiveBytes),
+        {symbolFromUtf8(-1, "recentCycles"), listFromRecentCycles(&stats)},
+        intMapping("totalPauseUsec",      stats.totalPauseUsec),
+        {NULL, NULL},  // `classes`, filled in below.
+        {NULL, NULL}   // `freedClasses`, filled in below.
+    };
+    zint size = sizeof(mappings) / sizeof(zmapping);
+
+    classMappings(&mappings[size - 2]);
+    return symtabFromZassoc((zassoc) {size, mappings});
+}
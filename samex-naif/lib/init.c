@@ -148,8 +148,9 @@ zvalue libNewEnvironment(const char *libraryPath) {
     datFrameReturn(save, result);
 
     // Force a garbage collection here, to have a maximally clean slate when
-    // moving into main program execution.
-    datGc();
+    // moving into main program execution. Everything that survives is
+    // permanent, so seal it, to keep it out of the way of future gcs.
+    datSealHeap();
 
     return result;
 }
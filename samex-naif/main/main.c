@@ -28,6 +28,11 @@ int main(int argc, char **argv) {
         die("Too few arguments.");
     }
 
+    const char *profilePath = getenv("SAMEX_PROFILE");
+    if ((profilePath != NULL) && (*profilePath != '\0')) {
+        datProfileStart(profilePath);
+    }
+
     char *libraryDir = getProgramDirectory(argv[0], "corelib");
     zvalue env = libNewEnvironment(libraryDir);
 
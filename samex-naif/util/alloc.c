@@ -4,6 +4,7 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <unistd.h>
 
 #include "util.h"
@@ -43,19 +44,37 @@ static intptr_t PAGE_SIZE = 0;
 static intptr_t PAGE_MASK = 0;
 
 /** Array of observed page ranges. */
-static PageRange ranges[UTIL_MAX_PAGE_RANGES];
+static PageRange *ranges = NULL;
 
 /** Number of active page ranges. */
 static zint rangesSize = 0;
 
+/** How many page ranges `ranges` can hold, before needing to grow. */
+static zint rangesMax = 0;
+
 /**
- * Convert address range to page range.
+ * Initializes `PAGE_SIZE` and `PAGE_MASK`, if not already done.
  */
-static PageRange pageRangeFromAddressRange(void *startPtr, void *endPtr) {
+static void initPageSize(void) {
     if (PAGE_MASK == 0) {
         PAGE_SIZE = getpagesize();
         PAGE_MASK = ~(PAGE_SIZE - 1);
     }
+}
+
+/**
+ * Rounds the given size up to a whole number of pages.
+ */
+static zint roundToPages(zint size) {
+    initPageSize();
+    return (size + PAGE_SIZE - 1) & PAGE_MASK;
+}
+
+/**
+ * Convert address range to page range.
+ */
+static PageRange pageRangeFromAddressRange(void *startPtr, void *endPtr) {
+    initPageSize();
 
     intptr_t start = ((intptr_t) startPtr) & PAGE_MASK;
     intptr_t end = ((intptr_t) endPtr + PAGE_SIZE - 1) & PAGE_MASK;
@@ -79,6 +98,32 @@ static int compareRanges(const void *r1, const void *r2) {
     }
 }
 
+/**
+ * Appends the given range to `ranges`, growing the array if necessary.
+ * This leaves `ranges` unsorted. The array is allocated with `calloc()`
+ * directly, since `utilAlloc()` would recurse back here.
+ */
+static void appendRange(PageRange range) {
+    if (rangesSize == rangesMax) {
+        zint newMax = (rangesMax == 0)
+            ? UTIL_PAGE_RANGES_MIN_SIZE
+            : rangesMax * 2;
+        PageRange *newRanges = calloc(newMax, sizeof(PageRange));
+
+        if (newRanges == NULL) {
+            die("Failed to allocate heap page ranges.");
+        }
+
+        utilCpy(PageRange, newRanges, ranges, rangesSize);
+        free(ranges);
+        ranges = newRanges;
+        rangesMax = newMax;
+    }
+
+    ranges[rangesSize] = range;
+    rangesSize++;
+}
+
 /**
  * Adds the page(s) of the given address range to the list of known-active
  * pages.
@@ -93,12 +138,7 @@ static void addPages(void *start, void *end) {
 
     // Need to add a new range or extend an existing one.
 
-    if (rangesSize >= UTIL_MAX_PAGE_RANGES) {
-        die("Too many heap page ranges!");
-    }
-
-    ranges[rangesSize] = range;
-    rangesSize++;
+    appendRange(range);
     mergesort(ranges, rangesSize, sizeof(PageRange), compareRanges);
 
     // Combine adjacent ranges (if possible).
@@ -125,6 +165,42 @@ static void addPages(void *start, void *end) {
     rangesSize = at;
 }
 
+/**
+ * Removes the page(s) of the given address range from the list of
+ * known-active pages.
+ */
+static void removePages(void *start, void *end) {
+    PageRange range = pageRangeFromAddressRange(start, end);
+    zint at = 0;
+    PageRange tail = {0, 0};
+
+    // Ranges are disjoint, so at most one of them can need to get split.
+
+    for (zint i = 0; i < rangesSize; i++) {
+        PageRange one = ranges[i];
+
+        if ((one.end > range.start) && (one.start < range.end)) {
+            if (one.end > range.end) {
+                tail = (PageRange) {range.end, one.end};
+            }
+
+            one.end = range.start;
+        }
+
+        if (one.start < one.end) {
+            ranges[at] = one;
+            at++;
+        }
+    }
+
+    rangesSize = at;
+
+    if (tail.start != tail.end) {
+        appendRange(tail);
+        mergesort(ranges, rangesSize, sizeof(PageRange), compareRanges);
+    }
+}
+
 
 //
 // Exported Definitions
@@ -149,11 +225,72 @@ void *utilAlloc(zint size) {
     return result;
 }
 
+// Documented in header.
+void *utilAllocPages(zint size, zint alignment) {
+    if (size < 0) {
+        die("Invalid allocation size: %lld", size);
+    }
+
+    if ((alignment & (alignment - 1)) != 0) {
+        die("Invalid allocation alignment: %lld", alignment);
+    }
+
+    size = roundToPages(size);
+
+    if (alignment < PAGE_SIZE) {
+        alignment = PAGE_SIZE;
+    }
+
+    // Over-allocate, so as to be able to find an aligned block in the
+    // middle, and then unmap the excess from either end.
+
+    zint mapSize = size + alignment - PAGE_SIZE;
+    char *base = mmap(NULL, mapSize, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (base == MAP_FAILED) {
+        die("Failed to allocate pages: size %#llx, alignment %#llx",
+            size, alignment);
+    }
+
+    char *result =
+        (char *) (((intptr_t) base + alignment - 1) & ~(alignment - 1));
+    zint headExcess = result - base;
+    zint tailExcess = mapSize - headExcess - size;
+
+    if (headExcess != 0) {
+        munmap(base, headExcess);
+    }
+
+    if (tailExcess != 0) {
+        munmap(result + size, tailExcess);
+    }
+
+    if (MEMORY_PARANOIA) {
+        addPages(result, result + size);
+    }
+
+    return result;
+}
+
 // Documented in header.
 void utilFree(void *memory) {
     free(memory);
 }
 
+// Documented in header.
+void utilFreePages(void *memory, zint size) {
+    size = roundToPages(size);
+
+    if (munmap(memory, size) != 0) {
+        die("Failed to free pages: %p", memory);
+    }
+
+    if (MEMORY_PARANOIA) {
+        removePages(memory, ((char *) memory) + size);
+    }
+}
+
 // Documented in header.
 bool utilIsHeapAllocated(void *memory) {
     if (!MEMORY_PARANOIA) {
@@ -13,8 +13,8 @@ enum {
     /** Maximum number of active stack frames. */
     UTIL_MAX_CALL_STACK_DEPTH = 4000,
 
-    /** Maximum number of disjoint heap allocation page ranges. */
-    UTIL_MAX_PAGE_RANGES = 400
+    /** Initial size of the array of heap allocation page ranges. */
+    UTIL_PAGE_RANGES_MIN_SIZE = 400
 };
 
 #endif
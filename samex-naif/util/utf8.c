@@ -2,6 +2,8 @@
 // Licensed AS IS and WITHOUT WARRANTY under the Apache License,
 // Version 2.0. Details: <http://www.apache.org/licenses/LICENSE-2.0>
 
+#include <string.h>
+
 #include "util.h"
 
 
@@ -49,6 +51,30 @@ static const char *getUtfEnd(zint utfBytes, const char *utf) {
     return result;
 }
 
+/**
+ * Gets the number of ASCII bytes at the start of the given range. This
+ * works a word at a time when possible, since the common case is text
+ * that is mostly (if not entirely) ASCII.
+ */
+static zint asciiPrefixSize(const char *utf, const char *utfEnd) {
+    const char *at = utf;
+
+    for (/*at*/; (utfEnd - at) >= 8; at += 8) {
+        uint64_t word;
+        memcpy(&word, at, 8);
+
+        if ((word & 0x8080808080808080ULL) != 0) {
+            break;
+        }
+    }
+
+    while ((at < utfEnd) && ((*at & 0x80) == 0)) {
+        at++;
+    }
+
+    return at - utf;
+}
+
 /**
  * Does the basic decoding step, with syntactic but not semantic validation.
  */
@@ -192,8 +218,14 @@ zint utf8DecodeStringSize(zint utfBytes, const char *utf) {
     zint result = 0;
 
     while (utf < utfEnd) {
-        utf = justDecode(NULL, utfEnd - utf, utf);
-        result++;
+        zint asciiSize = asciiPrefixSize(utf, utfEnd);
+        utf += asciiSize;
+        result += asciiSize;
+
+        if (utf < utfEnd) {
+            utf = justDecode(NULL, utfEnd - utf, utf);
+            result++;
+        }
     }
 
     return result;
@@ -204,8 +236,19 @@ void utf8DecodeCharsFromString(zchar *result, zint utfBytes, const char *utf) {
     const char *utfEnd = getUtfEnd(utfBytes, utf);
 
     while (utf < utfEnd) {
-        utf = decodeValid(result, utfEnd - utf, utf);
-        result++;
+        zint asciiSize = asciiPrefixSize(utf, utfEnd);
+
+        for (zint i = 0; i < asciiSize; i++) {
+            result[i] = (unsigned char) utf[i];
+        }
+
+        utf += asciiSize;
+        result += asciiSize;
+
+        if (utf < utfEnd) {
+            utf = decodeValid(result, utfEnd - utf, utf);
+            result++;
+        }
     }
 }
 
@@ -6,13 +6,72 @@
 
 #include "util.h"
 
+
+//
+// Private Definitions
+//
+
+/**
+ * Counts the bytes in the given array whose high bit is set. For a
+ * one-byte-wide string, this is the number of non-ASCII characters. This
+ * works a word at a time when possible, since the common case is text
+ * that is entirely ASCII.
+ */
+static zint countHighBytes(zint size, const uint8_t *bytes) {
+    zint result = 0;
+    zint i = 0;
+
+    for (/*i*/; (i + 8) <= size; i += 8) {
+        uint64_t word;
+        memcpy(&word, &bytes[i], 8);
+
+        if ((word & 0x8080808080808080ULL) == 0) {
+            continue;
+        }
+
+        for (zint j = i; j < (i + 8); j++) {
+            result += bytes[j] >> 7;
+        }
+    }
+
+    for (/*i*/; i < size; i++) {
+        result += bytes[i] >> 7;
+    }
+
+    return result;
+}
+
+
 //
 // Exported Definitions
 //
 
+// All documented in header.
+extern zchar zstringNth(zstring string, zint n);
+extern zstring zstringSlice(zstring string, zint start, zint size);
+extern zstring zstringFromZchars(zint size, const zchar *chars);
+
 // Documented in header.
 void arrayFromZstring(zchar *result, const zstring string) {
-    utilCpy(zchar, result, string.chars, string.size);
+    arrayFromZstringWidth(result, sizeof(zchar), string);
+}
+
+// Documented in header.
+void arrayFromZstringWidth(void *result, zint width, zstring string) {
+    if (width == string.width) {
+        memcpy(result, string.chars, string.size * width);
+        return;
+    }
+
+    for (zint i = 0; i < string.size; i++) {
+        zchar ch = zstringNth(string, i);
+
+        switch (width) {
+            case 1:  { ((uint8_t *) result)[i] = ch;  break; }
+            case 2:  { ((uint16_t *) result)[i] = ch; break; }
+            default: { ((zchar *) result)[i] = ch;    break; }
+        }
+    }
 }
 
 // Documented in header.
@@ -28,8 +87,42 @@ char *utf8DupFromZstring(zstring string) {
 zint utf8FromZstring(zint resultSize, char *result, zstring string) {
     char *out = result;
 
-    for (zint i = 0; i < string.size; i++) {
-        out = utf8EncodeOne(out, string.chars[i]);
+    if ((string.width == 1)
+        && (countHighBytes(string.size, string.chars) == 0)) {
+        // All ASCII, which means the UTF-8 encoding is just a copy.
+        if (string.size >= resultSize) {
+            die("Buffer too small for UTF-8-encoded string.");
+        }
+
+        memcpy(out, string.chars, string.size);
+        out += string.size;
+    } else if (string.width == 1) {
+        // Latin-1 characters encode as either one or two bytes.
+        const uint8_t *chars = string.chars;
+
+        for (zint i = 0; i < string.size; i++) {
+            uint8_t ch = chars[i];
+
+            if (ch < 0x80) {
+                *out = (char) ch;
+                out++;
+            } else {
+                out[0] = (char) (0xc0 | (ch >> 6));
+                out[1] = (char) (0x80 | (ch & 0x3f));
+                out += 2;
+            }
+        }
+    } else {
+        for (zint i = 0; i < string.size; i++) {
+            zchar ch = zstringNth(string, i);
+
+            if (ch < 0x80) {
+                *out = (char) ch;
+                out++;
+            } else {
+                out = utf8EncodeOne(out, ch);
+            }
+        }
     }
 
     *out = '\0';
@@ -46,10 +139,16 @@ zint utf8FromZstring(zint resultSize, char *result, zstring string) {
 
 // Documented in header.
 zint utf8SizeFromZstring(zstring string) {
+    if (string.width == 1) {
+        // Latin-1 characters take one byte if ASCII, or two bytes if not.
+        return string.size + countHighBytes(string.size, string.chars);
+    }
+
     zint result = 0;
 
     for (zint i = 0; i < string.size; i++) {
-        result += (utf8EncodeOne(NULL, string.chars[i]) - (char *) NULL);
+        zchar ch = zstringNth(string, i);
+        result += (ch < 0x80) ? 1 : (utf8EncodeOne(NULL, ch) - (char *) NULL);
     }
 
     return result;
@@ -61,34 +160,71 @@ bool zstringEq(zstring string1, zstring string2) {
 
     if (size != string2.size) {
         return false;
-    } else if (string1.chars == string2.chars) {
-        return true;
+    } else if (string1.width == string2.width) {
+        return (string1.chars == string2.chars)
+            || (memcmp(string1.chars, string2.chars, size * string1.width)
+                == 0);
+    }
+
+    for (zint i = 0; i < size; i++) {
+        if (zstringNth(string1, i) != zstringNth(string2, i)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Documented in header.
+zint zstringMinWidth(zstring string) {
+    if (string.width == 1) {
+        return 1;
     }
 
-    return utilCmp(zchar, string1.chars, string2.chars, size) == 0;
+    zint result = 1;
+
+    for (zint i = 0; i < string.size; i++) {
+        zchar ch = zstringNth(string, i);
+
+        if (ch > 0xffff) {
+            return 4;
+        } else if (ch > 0xff) {
+            result = 2;
+        }
+    }
+
+    return result;
 }
 
 // Documented in header.
 zorder zstringOrder(zstring string1, zstring string2) {
     zint size1 = string1.size;
     zint size2 = string2.size;
-    const zchar *chars1 = string1.chars;
-    const zchar *chars2 = string2.chars;
 
-    if ((size1 == size2) && (chars1 == chars2)) {
+    if ((size1 == size2) && (string1.chars == string2.chars)
+        && (string1.width == string2.width)) {
         return ZSAME;
     }
 
     zint size = (size1 < size2) ? size1 : size2;
 
-    for (zint i = 0; i < size; i++) {
-        zchar c1 = chars1[i];
-        zchar c2 = chars2[i];
+    if ((string1.width == 1) && (string2.width == 1)) {
+        // Byte order is character order, for one-byte characters.
+        int result = memcmp(string1.chars, string2.chars, size);
 
-        if (c1 < c2) {
-            return ZLESS;
-        } else if (c1 > c2) {
-            return ZMORE;
+        if (result != 0) {
+            return (result < 0) ? ZLESS : ZMORE;
+        }
+    } else {
+        for (zint i = 0; i < size; i++) {
+            zchar c1 = zstringNth(string1, i);
+            zchar c2 = zstringNth(string2, i);
+
+            if (c1 < c2) {
+                return ZLESS;
+            } else if (c1 > c2) {
+                return ZMORE;
+            }
         }
     }
 